@@ -0,0 +1,48 @@
+#include "AccessIndex.hpp"
+
+void AccessIndex::SortedPairs::build(std::vector<std::pair<uint64_t, unsigned>>& pairs) {
+	std::sort(pairs.begin(), pairs.end());
+
+	keys.resize(pairs.size());
+	counts.resize(pairs.size());
+	totals.resize(pairs.size() + 1U);
+	totals[0] = 0U;
+	for (size_t i{ 0U }; i < pairs.size(); ++i) {
+		keys[i] = pairs[i].first;
+		counts[i] = pairs[i].second;
+		totals[i + 1U] = totals[i] + pairs[i].second;
+	}
+}
+
+std::pair<size_t, size_t> AccessIndex::SortedPairs::find(uint64_t first, uint64_t last) const {
+	const auto begin{ std::lower_bound(keys.begin(), keys.end(), first) };
+	const auto end{ std::upper_bound(begin, keys.end(), last) };
+	return { static_cast<size_t>(begin - keys.begin()), static_cast<size_t>(end - keys.begin()) };
+}
+
+AccessIndex::AccessIndex(const PortMap& portMap) : m_byIp{}, m_byPort{} {
+	// Gather the pairs of every port, keyed in port order
+	std::vector<std::pair<uint64_t, unsigned>> pairs;
+	portMap.forEach([&pairs](const PortMap::Entry& portEntry) {
+		const uint16_t port{ portEntry.first.port() };
+		portEntry.second.forEach([&pairs, port](const IpMap::Entry& ipEntry) {
+			pairs.emplace_back(portKey(port, ipEntry.first.address()), ipEntry.second);
+		});
+	});
+	m_byPort.build(pairs);
+
+	// Then rekey the same pairs in ip order
+	for (auto& pair : pairs) {
+		const PackedAddress access{ portPair(pair.first) };
+		pair.first = access.value();
+	}
+	m_byIp.build(pairs);
+}
+
+RangeCount AccessIndex::countIps(const Ip& first, const Ip& last) const {
+	return m_byIp.count(m_byIp.find(PackedAddress{ first.address(), 0U }.value(), PackedAddress{ last.address(), UINT16_MAX }.value()));
+}
+
+RangeCount AccessIndex::countPorts(const Port& first, const Port& last) const {
+	return m_byPort.count(m_byPort.find(portKey(first.port(), 0U), portKey(last.port(), UINT32_MAX)));
+}
@@ -0,0 +1,166 @@
+#ifndef ACCESS_INDEX_HPP
+#define ACCESS_INDEX_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "NetMap.hpp"
+
+
+/**
+ * Number of distinct port and ip pairs and of accesses in a range.
+ */
+struct RangeCount {
+	size_t pairs; // Number of distinct port and ip pairs
+	uint64_t accesses; // Number of accesses
+};
+
+/**
+* Sorted flat index of the port and ip pairs of a port map, for range
+* queries such as every access from 10.0.0.0 to 10.255.255.255, or every
+* access to the ports 1000 to 2000, without a scan of the whole map.
+*
+* The pairs are kept twice, ordered by ip then port, the order of
+* PackedAddress and IpAddress, and ordered by port then ip. Each order is a
+* sorted array of packed keys, apart from the counts, so a binary search
+* only reads keys and a range is read front to back. Running totals of the
+* counts give the accesses of a range from the two ends of the range alone.
+*
+* The index is built in bulk and does not follow later changes of the map.
+*
+* @return AccessIndex
+*/
+class AccessIndex {
+	/**
+	 * One order of the pairs.
+	 */
+	struct SortedPairs {
+		std::vector<uint64_t> keys; // Packed pairs, sorted
+		std::vector<unsigned> counts; // Accesses of each pair
+		std::vector<uint64_t> totals; // Accesses of the pairs before each one, and of all of them at the end
+
+		/**
+		* Sorts the pairs by their key and fills the running totals.
+		* Time: O(n log n)
+		* Space: O(n)
+		*
+		* @param pairs Key and count of each pair, reordered
+		*/
+		void build(std::vector<std::pair<uint64_t, unsigned>>& pairs);
+
+		/**
+		* Gets the positions of the pairs with keys in a range.
+		* Time: O(log n)
+		* Space: O(1)
+		*
+		* @param first First key of the range
+		* @param last Last key of the range, included
+		* @return First position in the range and the one after it
+		*/
+		std::pair<size_t, size_t> find(uint64_t first, uint64_t last) const;
+
+		/**
+		* Counts the pairs and accesses between two positions.
+		*/
+		RangeCount count(std::pair<size_t, size_t> range) const {
+			return { range.second - range.first, totals[range.second] - totals[range.first] };
+		}
+	};
+
+	SortedPairs m_byIp; // Pairs keyed by address then port, as PackedAddress::value()
+	SortedPairs m_byPort; // Pairs keyed by port then address
+
+	/**
+	* Packs a pair into its key in port order.
+	*/
+	static uint64_t portKey(uint16_t port, uint32_t address) { return (uint64_t{ port } << 32) | address; }
+
+	/**
+	* Gets the pair of a key in ip order.
+	*/
+	static PackedAddress ipPair(uint64_t key) { return PackedAddress{ static_cast<uint32_t>(key >> 16), static_cast<uint16_t>(key) }; }
+
+	/**
+	* Gets the pair of a key in port order.
+	*/
+	static PackedAddress portPair(uint64_t key) { return PackedAddress{ static_cast<uint32_t>(key), static_cast<uint16_t>(key >> 32) }; }
+
+public:
+	AccessIndex() : m_byIp{}, m_byPort{} {}
+
+	/**
+	* Builds the index of the pairs of a port map.
+	* Time: O(m log m), m being the pairs of the map
+	* Space: O(m)
+	*
+	* @param portMap Map to index
+	*/
+	explicit AccessIndex(const PortMap& portMap);
+
+	/**
+	* Counts the accesses from the ips of a range, to any port.
+	* Time: O(log m)
+	* Space: O(1)
+	*
+	* @param first First ip of the range
+	* @param last Last ip of the range, included
+	*/
+	RangeCount countIps(const Ip& first, const Ip& last) const;
+
+	/**
+	* Counts the accesses to the ports of a range, from any ip.
+	* Time: O(log m)
+	* Space: O(1)
+	*
+	* @param first First port of the range
+	* @param last Last port of the range, included
+	*/
+	RangeCount countPorts(const Port& first, const Port& last) const;
+
+	/**
+	* Runs a callback on the pairs with the ips of a range, in ip then port order.
+	* Time: O(log m + k), k being the pairs of the range
+	* Space: O(1)
+	*
+	* @param first First ip of the range
+	* @param last Last ip of the range, included
+	* @param func Function taking the const PackedAddress& pair and its unsigned count
+	*/
+	template <class PairFunction>
+	void forEachIp(const Ip& first, const Ip& last, PairFunction func) const {
+		const auto range{ m_byIp.find(PackedAddress{ first.address(), 0U }.value(), PackedAddress{ last.address(), UINT16_MAX }.value()) };
+		for (size_t i{ range.first }; i < range.second; ++i) {
+			func(ipPair(m_byIp.keys[i]), m_byIp.counts[i]);
+		}
+	}
+
+	/**
+	* Runs a callback on the pairs with the ports of a range, in port then ip order.
+	* Time: O(log m + k), k being the pairs of the range
+	* Space: O(1)
+	*
+	* @param first First port of the range
+	* @param last Last port of the range, included
+	* @param func Function taking the const PackedAddress& pair and its unsigned count
+	*/
+	template <class PairFunction>
+	void forEachPort(const Port& first, const Port& last, PairFunction func) const {
+		const auto range{ m_byPort.find(portKey(first.port(), 0U), portKey(last.port(), UINT32_MAX)) };
+		for (size_t i{ range.first }; i < range.second; ++i) {
+			func(portPair(m_byPort.keys[i]), m_byPort.counts[i]);
+		}
+	}
+
+	/**
+	* Gets the number of indexed pairs.
+	*/
+	size_t size() const { return m_byIp.keys.size(); }
+};
+
+#endif // !ACCESS_INDEX_HPP
@@ -0,0 +1,414 @@
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Timer.hpp"
+#include "IpAddress.hpp"
+#include "PackedAddress.hpp"
+#include "HashMap.hpp"
+#include "HashMapInternalChaining.hpp"
+#include "ConcurrentHashMap.hpp"
+
+
+/**
+* Mixes the keys of the benchmarks, which are packed addresses.
+*/
+struct KeyHasher {
+	size_t operator()(uint64_t key) const { return static_cast<size_t>(PackedAddress::mix(key)); }
+};
+
+/**
+* Hashes IpAddress keys through their packed form.
+*/
+struct IpAddressHasher {
+	size_t operator()(const IpAddress& ip) const { return PackedAddress::Hasher{}(PackedAddress{ ip }); }
+};
+
+/**
+* Baseline for the contention benchmark: the unsynchronized map behind a single mutex.
+*/
+class LockedMap {
+	std::mutex m_mutex;
+	HashMapInternalChaining<uint64_t, unsigned, KeyHasher> m_map;
+
+public:
+	void increment(uint64_t key) {
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_map.upsert(key, 1U, [](unsigned& count) { count++; });
+	}
+
+	size_t size() {
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		return m_map.size();
+	}
+};
+
+/**
+* Runs the same number of increments on each thread and measures the throughput.
+* Time: O(t * n)
+* Space: O(k)
+*
+* @param map Map to increment the counters of
+* @param keys Keys to increment, each thread walks all of them from a different offset
+* @param numThreads Number of threads
+* @param opsPerThread Number of increments of each thread
+* @return Millions of increments per second
+*/
+template <class Map>
+double runContention(Map& map, const std::vector<uint64_t>& keys, unsigned numThreads, size_t opsPerThread) {
+	std::vector<std::thread> threads;
+	Timer timer;
+	for (unsigned t{ 0U }; t < numThreads; ++t) {
+		threads.emplace_back([&map, &keys, t, numThreads, opsPerThread]() {
+			size_t k{ keys.size() / numThreads * t };
+			for (size_t i{ 0U }; i < opsPerThread; ++i) {
+				map.increment(keys[k]);
+				if (++k == keys.size()) {
+					k = 0U;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	return numThreads * opsPerThread / timer.elapsed() / 1e6;
+}
+
+/**
+* Builds the keys of the benchmark: random addresses and ports, each repeated in a shuffled order.
+* Time: O(n)
+* Space: O(n)
+*
+* @param numKeys Number of distinct keys
+* @param numOps Length of the key sequence
+* @return Key sequence
+*/
+std::vector<uint64_t> makeKeys(size_t numKeys, size_t numOps) {
+	std::mt19937_64 rng{ 20201121U };
+	std::vector<uint64_t> distinct(numKeys);
+	for (auto& key : distinct) {
+		key = PackedAddress{ static_cast<uint32_t>(rng()), static_cast<uint16_t>(rng()) }.value();
+	}
+
+	std::vector<uint64_t> keys(numOps);
+	std::uniform_int_distribution<size_t> pick{ 0U, numKeys - 1U };
+	for (auto& key : keys) {
+		key = distinct[pick(rng)];
+	}
+	return keys;
+}
+
+/**
+* Names of the maps of the project in the benchmark results.
+*/
+template <class K, class T, class Hasher, class Probing>
+const char* containerName(const HashMap<K, T, Hasher, Probing>&) { return "HashMap"; }
+
+template <class K, class T, class Hasher, size_t InlineCapacity>
+const char* containerName(const HashMapInternalChaining<K, T, Hasher, InlineCapacity>&) { return "HashMapInternalChaining"; }
+
+/**
+* Runs the operations of the container benchmark on one of the maps of the
+* project, which share their interface.
+*/
+template <class Map>
+struct ProjectMap {
+	Map map;
+
+	const char* name() const { return containerName(map); }
+
+	void maxLoadFactor(float ml) { map.max_load_factor(ml); }
+	template <class Key>
+	void insert(const Key& key, uint64_t value) { map.insert(key, value); }
+
+	template <class Key>
+	bool contains(const Key& key) { return map.find(key) != nullptr; }
+
+	template <class Key>
+	void erase(const Key& key) { map.erase(key); }
+
+	uint64_t sum() const {
+		uint64_t total{ 0U };
+		map.forEach([&total](const typename Map::Entry& entry) { total += entry.second; });
+		return total;
+	}
+};
+
+/**
+* Runs the operations of the container benchmark on std::unordered_map.
+*/
+template <class Key, class Hasher>
+struct StdMap {
+	std::unordered_map<Key, uint64_t, Hasher> map;
+
+	const char* name() const { return "std::unordered_map"; }
+
+	void maxLoadFactor(float ml) { map.max_load_factor(ml); }
+	void insert(const Key& key, uint64_t value) { map.emplace(key, value); }
+	bool contains(const Key& key) { return map.find(key) != map.end(); }
+	void erase(const Key& key) { map.erase(key); }
+
+	uint64_t sum() const {
+		uint64_t total{ 0U };
+		for (const auto& entry : map) {
+			total += entry.second;
+		}
+		return total;
+	}
+};
+
+/**
+* Keys of one type of the container benchmark, built from random packed addresses.
+*/
+template <class Key>
+struct KeyType;
+
+template <>
+struct KeyType<uint64_t> {
+	static constexpr const char* name{ "packed" };
+	using Hasher = KeyHasher;
+	static uint64_t make(uint64_t packed) { return packed; }
+};
+
+template <>
+struct KeyType<IpAddress> {
+	static constexpr const char* name{ "IpAddress" };
+	using Hasher = IpAddressHasher;
+	static IpAddress make(uint64_t packed) { return PackedAddress{ static_cast<uint32_t>(packed >> 16), static_cast<uint16_t>(packed) }.toIpAddress(); }
+};
+
+template <>
+struct KeyType<std::string> {
+	static constexpr const char* name{ "string" };
+	using Hasher = std::hash<std::string>;
+	static std::string make(uint64_t packed) { return KeyType<IpAddress>::make(packed).str(); }
+};
+
+/**
+* Draws indices of a sequence with a Zipfian distribution, the i-th one with probability proportional to 1 / (i + 1)^s.
+* Time: O(n + m log n)
+* Space: O(n + m)
+*
+* @param n Number of indices
+* @param m Number of draws
+* @param s Skew of the distribution
+* @param rng Random generator
+* @return Drawn indices
+*/
+std::vector<size_t> zipfIndices(size_t n, size_t m, double s, std::mt19937_64& rng) {
+	std::vector<double> cdf(n);
+	double total{ 0.0 };
+	for (size_t i{ 0U }; i < n; ++i) {
+		total += 1.0 / std::pow(static_cast<double>(i + 1U), s);
+		cdf[i] = total;
+	}
+
+	std::vector<size_t> indices(m);
+	std::uniform_real_distribution<double> pick{ 0.0, total };
+	for (auto& index : indices) {
+		index = std::min(static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), pick(rng)) - cdf.begin()), n - 1U);
+	}
+	return indices;
+}
+
+/**
+* Prints one result of the container benchmark as a csv row.
+*/
+void printResult(const char* container, const char* key, size_t size, float maxLoadFactor, const char* operation, const char* distribution, size_t ops, double seconds) {
+	std::cout << container << ',' << key << ',' << size << ',' << maxLoadFactor << ',' << operation << ',' << distribution << ','
+		<< ops << ',' << seconds << ',' << ops / seconds / 1e6 << '\n';
+}
+
+/**
+* Measures insert, hit and miss lookup, iteration and erase throughput of a map
+* holding a given number of keys, printing one csv row per operation.
+* Time: O(n + l)
+* Space: O(n + l)
+*
+* @param keys Keys to insert, distinct
+* @param misses Keys that are not inserted
+* @param uniform Indices of the keys to look up with a uniform distribution
+* @param zipf Indices of the keys to look up with a Zipfian distribution
+* @param maxLoadFactor Maximum load factor of the map
+* @return Checksum of the results, so no operation is optimized away
+*/
+template <class Map, class Key>
+uint64_t runContainer(const std::vector<Key>& keys, const std::vector<Key>& misses, const std::vector<size_t>& uniform, const std::vector<size_t>& zipf, float maxLoadFactor) {
+	const char* keyName{ KeyType<Key>::name };
+	uint64_t checksum{ 0U };
+	Map map;
+	map.maxLoadFactor(maxLoadFactor);
+
+	Timer timer;
+	for (size_t i{ 0U }; i < keys.size(); ++i) {
+		map.insert(keys[i], i);
+	}
+	printResult(map.name(), keyName, keys.size(), maxLoadFactor, "insert", "none", keys.size(), timer.elapsed());
+
+	for (const auto* lookups : { &uniform, &zipf }) {
+		timer.reset();
+		for (size_t index : *lookups) {
+			checksum += map.contains(keys[index]);
+		}
+		printResult(map.name(), keyName, keys.size(), maxLoadFactor, "hit", lookups == &uniform ? "uniform" : "zipf", lookups->size(), timer.elapsed());
+	}
+
+	timer.reset();
+	for (size_t i{ 0U }; i < uniform.size(); ++i) {
+		checksum += map.contains(misses[i % misses.size()]);
+	}
+	printResult(map.name(), keyName, keys.size(), maxLoadFactor, "miss", "uniform", uniform.size(), timer.elapsed());
+
+	// Iterate until about as many entries as lookups are visited
+	const size_t rounds{ std::max(uniform.size() / keys.size(), size_t{ 1U }) };
+	timer.reset();
+	for (size_t r{ 0U }; r < rounds; ++r) {
+		checksum += map.sum();
+	}
+	printResult(map.name(), keyName, keys.size(), maxLoadFactor, "iterate", "none", rounds * keys.size(), timer.elapsed());
+
+	timer.reset();
+	for (const Key& key : keys) {
+		map.erase(key);
+	}
+	printResult(map.name(), keyName, keys.size(), maxLoadFactor, "erase", "none", keys.size(), timer.elapsed());
+
+	return checksum;
+}
+
+/**
+* Runs the container benchmark on every map for one key type, sweeping the sizes and load factors.
+*
+* @param sizes Numbers of keys
+* @param maxLoadFactors Maximum load factors
+* @param numLookups Number of lookups of each lookup measurement
+* @param zipfSkew Skew of the Zipfian lookups
+* @return Checksum of the results
+*/
+template <class Key>
+uint64_t runContainers(const std::vector<size_t>& sizes, const std::vector<float>& maxLoadFactors, size_t numLookups, double zipfSkew) {
+	using Hasher = typename KeyType<Key>::Hasher;
+	uint64_t checksum{ 0U };
+	std::mt19937_64 rng{ 20201121U };
+	for (size_t size : sizes) {
+		// Distinct keys, the first ones inserted and the rest only looked up
+		std::vector<uint64_t> packed(size * 2U);
+		for (auto& key : packed) {
+			key = PackedAddress{ static_cast<uint32_t>(rng()), static_cast<uint16_t>(rng()) }.value();
+		}
+		std::sort(packed.begin(), packed.end());
+		packed.erase(std::unique(packed.begin(), packed.end()), packed.end());
+		std::shuffle(packed.begin(), packed.end(), rng);
+
+		std::vector<Key> keys;
+		std::vector<Key> misses;
+		for (size_t i{ 0U }; i < packed.size(); ++i) {
+			(i < size ? keys : misses).push_back(KeyType<Key>::make(packed[i]));
+		}
+
+		std::vector<size_t> uniform(numLookups);
+		std::uniform_int_distribution<size_t> pick{ 0U, keys.size() - 1U };
+		for (auto& index : uniform) {
+			index = pick(rng);
+		}
+		const std::vector<size_t> zipf{ zipfIndices(keys.size(), numLookups, zipfSkew, rng) };
+
+		for (float maxLoadFactor : maxLoadFactors) {
+			checksum += runContainer<ProjectMap<HashMap<Key, uint64_t, Hasher>>>(keys, misses, uniform, zipf, maxLoadFactor);
+			checksum += runContainer<ProjectMap<HashMapInternalChaining<Key, uint64_t, Hasher>>>(keys, misses, uniform, zipf, maxLoadFactor);
+			checksum += runContainer<StdMap<Key, Hasher>>(keys, misses, uniform, zipf, maxLoadFactor);
+		}
+	}
+	return checksum;
+}
+
+/**
+* Runs the container benchmark, printing the results as csv on std::cout.
+*
+* @param maxSize Largest number of keys, the sizes grow by 16 from 1024
+* @param numLookups Number of lookups of each lookup measurement
+*/
+void runContainerSuite(size_t maxSize, size_t numLookups) {
+	std::vector<size_t> sizes;
+	for (size_t size{ 1U << 10 }; size <= maxSize; size *= 16U) {
+		sizes.push_back(size);
+	}
+	const std::vector<float> maxLoadFactors{ 0.5F, 0.75F, 0.875F };
+	const double zipfSkew{ 0.99 };
+
+	std::cout << "container,key,size,max_load_factor,operation,distribution,ops,seconds,mops\n";
+	uint64_t checksum{ 0U };
+	checksum += runContainers<uint64_t>(sizes, maxLoadFactors, numLookups, zipfSkew);
+	checksum += runContainers<IpAddress>(sizes, maxLoadFactors, numLookups, zipfSkew);
+	checksum += runContainers<std::string>(sizes, maxLoadFactors, numLookups, zipfSkew);
+	std::cerr << "Checksum: " << checksum << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	// Options given as "--suite contention|containers", "--ops N", "--keys N", "--threads N" and "--max-size N".
+	// The container suite takes --ops as the number of lookups of each measurement
+	std::string suite{ "contention" };
+	size_t opsPerThread{ 2000000U };
+	size_t numKeys{ 8192U };
+	unsigned maxThreads{ std::max(std::thread::hardware_concurrency(), 1U) };
+	size_t maxSize{ 1U << 20 };
+	for (int i{ 1 }; i + 1 < argc; i += 2) {
+		const std::string option{ argv[i] };
+		if (option == "--suite") {
+			suite = argv[i + 1];
+		}
+		else if (option == "--ops") {
+			opsPerThread = std::stoul(argv[i + 1]);
+		}
+		else if (option == "--keys") {
+			numKeys = std::max(std::stoul(argv[i + 1]), 1UL);
+		}
+		else if (option == "--threads") {
+			maxThreads = std::max(static_cast<unsigned>(std::stoul(argv[i + 1])), 1U);
+		}
+		else if (option == "--max-size") {
+			maxSize = std::max(std::stoul(argv[i + 1]), 1UL << 10);
+		}
+		else {
+			std::cerr << "[ERROR] Unknown argument '" << option << "'. Usage: " << argv[0] << " [--suite contention|containers] [--ops N] [--keys N] [--threads N] [--max-size N]" << std::endl;
+			return 1;
+		}
+	}
+
+	// Throughput of each container operation, as csv
+	if (suite == "containers") {
+		runContainerSuite(maxSize, opsPerThread);
+		return 0;
+	}
+	if (suite != "contention") {
+		std::cerr << "[ERROR] Unknown suite '" << suite << "'" << std::endl;
+		return 1;
+	}
+
+	const std::vector<uint64_t> keys{ makeKeys(numKeys, 1U << 20) };
+
+	std::cout << "Contention benchmark: " << opsPerThread << " increments per thread over " << numKeys << " keys\n";
+	std::cout << std::setw(8) << "threads" << std::setw(16) << "mutex Mops/s" << std::setw(16) << "striped Mops/s" << '\n';
+	for (unsigned numThreads{ 1U }; numThreads <= maxThreads; numThreads *= 2U) {
+		LockedMap lockedMap;
+		const double locked{ runContention(lockedMap, keys, numThreads, opsPerThread) };
+
+		ConcurrentHashMap<uint64_t, unsigned, KeyHasher> concurrentMap;
+		const double striped{ runContention(concurrentMap, keys, numThreads, opsPerThread) };
+
+		std::cout << std::setw(8) << numThreads << std::fixed << std::setprecision(2) << std::setw(16) << locked << std::setw(16) << striped << '\n';
+	}
+}
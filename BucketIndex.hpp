@@ -0,0 +1,278 @@
+#ifndef BUCKET_INDEX_HPP
+#define BUCKET_INDEX_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/**
+ * Bucket index policies for HashMap and HashMapInternalChaining. A policy
+ * picks the bucket counts a table can have and reduces the full hash of a
+ * key to a bucket of the table, none of them with an integer division:
+ *
+ * ModuloIndex takes any bucket count and grows it to 2n + 1. The index is
+ * exactly h % n, computed with a reciprocal of n precomputed when the table
+ * is built, so a table iterates in the same order as with a division.
+ * PowerOfTwoIndex keeps power of two bucket counts and masks the low bits of
+ * the hash, for hashers that already mix every bit of the key into them.
+ * PrimeIndex keeps prime bucket counts that about double as they grow and
+ * reduces a 32 bit fold of the hash with a precomputed reciprocal.
+ * FixedIndex<N> has a bucket count of N that never changes, so the index is
+ * h % N of a constant, which the compiler turns into multiplications.
+ *
+ * Each policy is built from a bucket count and has:
+ *   size_t operator()(uint64_t h) const: bucket index of a hash
+ *   static size_t roundUp(size_t count): bucket count of a table asked for count buckets
+ *   static size_t grow(size_t count): bucket count of the table after one of count buckets, count if it cannot grow
+ */
+
+
+/**
+ * Gets the high 64 bits of the 128 bit product of two words.
+ * Time: O(1)
+ * Space: O(1)
+ */
+inline uint64_t mulHigh(uint64_t lhs, uint64_t rhs) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return __umulh(lhs, rhs);
+#elif defined(__SIZEOF_INT128__)
+	return static_cast<uint64_t>((static_cast<unsigned __int128>(lhs) * rhs) >> 64);
+#else
+	const uint64_t lhsLow{ lhs & UINT32_MAX }, lhsHigh{ lhs >> 32 };
+	const uint64_t rhsLow{ rhs & UINT32_MAX }, rhsHigh{ rhs >> 32 };
+	const uint64_t cross{ lhsHigh * rhsLow + ((lhsLow * rhsLow) >> 32) };
+	return lhsHigh * rhsHigh + (cross >> 32) + ((lhsLow * rhsHigh + (cross & UINT32_MAX)) >> 32);
+#endif
+}
+
+
+/**
+ * Bucket counts of any size, indexed by the remainder of the hash.
+ *
+ * The remainder is h - q * n, with the quotient q taken from the high word
+ * of h times a 65 bit reciprocal of n precomputed for the table, the way
+ * compilers divide by a constant. It is exact for every hash, so the buckets
+ * are the ones a division gives.
+ *
+ * @return ModuloIndex
+ */
+class ModuloIndex {
+	uint64_t m_count; // Number of buckets
+	uint64_t m_magic; // Low word of the reciprocal, floor(2^(64 + s) / n) rounded up, zero for powers of two
+	unsigned m_shift; // s, floor(log2(n)), one less for powers of two
+
+public:
+	/**
+	* Constructor of the index, precomputing the reciprocal of the bucket count.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param count Number of buckets
+	*/
+	explicit ModuloIndex(size_t count = 0U) : m_count{ count }, m_magic{ 0U }, m_shift{ 0U } {
+		if (count <= 1U) {
+			return;
+		}
+
+		unsigned log{ 63U };
+		while ((m_count >> log) == 0U) {
+			--log;
+		}
+		if ((m_count & (m_count - 1U)) == 0U) {
+			m_shift = log - 1U;
+			return;
+		}
+
+		// floor(2^(64 + log) / n) by long division, the high word 2^log is below n so it fits a word
+		uint64_t remainder{ uint64_t{ 1U } << log };
+		uint64_t quotient{ 0U };
+		for (unsigned bit{ 64U }; bit != 0U; --bit) {
+			const bool carry{ (remainder >> 63) != 0U };
+			remainder <<= 1;
+			quotient <<= 1;
+			if (carry || remainder >= m_count) {
+				remainder -= m_count;
+				quotient |= 1U;
+			}
+		}
+
+		// One more bit of precision, the 2^64 of the 65 bit reciprocal is added back by operator()
+		const uint64_t twice{ remainder * 2U };
+		m_magic = quotient * 2U + ((twice >= m_count || twice < remainder) ? 1U : 0U) + 1U;
+		m_shift = log;
+	}
+
+	/**
+	* Gets the bucket of a hash, h % n.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param h Full hash of a key
+	* @return Bucket index
+	*/
+	size_t operator()(uint64_t h) const {
+		const uint64_t high{ mulHigh(m_magic, h) };
+		const uint64_t quotient{ (((h - high) >> 1) + high) >> m_shift };
+		const uint64_t remainder{ h - quotient * m_count };
+		return static_cast<size_t>(m_count > 1U ? remainder : 0U);
+	}
+
+	static size_t roundUp(size_t count) { return count; }
+
+	static size_t grow(size_t count) { return count * 2U + 1U; }
+};
+
+
+/**
+ * Power of two bucket counts, indexed by masking the low log2(n) bits of the
+ * hash. It needs a hasher that mixes, such as PackedAddress::Hasher, since
+ * keys that only differ in their high hash bits share a bucket.
+ *
+ * Each bucket of a table splits into two buckets of a table twice its size,
+ * so filling a table in the iteration order of another one spreads the keys
+ * over all of its buckets, instead of piling them up at the start of it as
+ * taking the top bits of the hash would.
+ *
+ * @return PowerOfTwoIndex
+ */
+class PowerOfTwoIndex {
+	size_t m_mask; // Number of buckets minus one
+
+public:
+	/**
+	* Constructor of the index.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param count Number of buckets, a power of two from roundUp() or grow()
+	*/
+	explicit PowerOfTwoIndex(size_t count = 0U) : m_mask{ count == 0U ? 0U : count - 1U } {}
+
+	/**
+	* Gets the bucket of a hash, its low bits.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param h Full hash of a key
+	* @return Bucket index
+	*/
+	size_t operator()(uint64_t h) const { return static_cast<size_t>(h) & m_mask; }
+
+	/**
+	* Gets the smallest power of two of at least two and at least a count.
+	*/
+	static size_t roundUp(size_t count) {
+		size_t rounded{ 2U };
+		while (rounded < count) {
+			rounded <<= 1;
+		}
+		return rounded;
+	}
+
+	static size_t grow(size_t count) { return roundUp(count * 2U); }
+};
+
+
+/**
+ * Prime bucket counts, each about twice the one before it, indexed by the
+ * remainder of the hash folded to 32 bits.
+ *
+ * The remainder is taken with a 64 bit fixed point reciprocal of the count,
+ * floor(2^64 / n) + 1, which is exact for 32 bit hashes and counts.
+ *
+ * @return PrimeIndex
+ */
+class PrimeIndex {
+public:
+	// Bucket counts, the first prime from each power of two, and the last prime under 2^32
+	static constexpr uint32_t kPrimes[]{
+		2U, 5U, 11U, 17U, 37U, 67U, 131U, 257U,
+		521U, 1031U, 2053U, 4099U, 8209U, 16411U, 32771U, 65537U,
+		131101U, 262147U, 524309U, 1048583U, 2097169U, 4194319U, 8388617U, 16777259U,
+		33554467U, 67108879U, 134217757U, 268435459U, 536870923U, 1073741827U, 2147483659U, 4294967291U
+	};
+
+private:
+	uint64_t m_inverse; // floor(2^64 / n) + 1
+	uint64_t m_count; // Number of buckets
+
+public:
+	/**
+	* Constructor of the index, precomputing the reciprocal of the bucket count.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param count Number of buckets, a prime from roundUp() or grow()
+	*/
+	explicit PrimeIndex(size_t count = 0U) : m_inverse{ count == 0U ? 0U : UINT64_MAX / count + 1U }, m_count{ count } {}
+
+	/**
+	* Gets the bucket of a hash, the hash folded to 32 bits modulo n.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param h Full hash of a key
+	* @return Bucket index
+	*/
+	size_t operator()(uint64_t h) const {
+		const uint32_t folded{ static_cast<uint32_t>(h ^ (h >> 32)) };
+		return static_cast<size_t>(mulHigh(m_inverse * folded, m_count));
+	}
+
+	/**
+	* Gets the smallest bucket count of the table of at least a count.
+	*
+	* @throw std::length_error If the count is over the largest prime
+	*/
+	static size_t roundUp(size_t count) {
+		for (const uint32_t prime : kPrimes) {
+			if (prime >= count) {
+				return prime;
+			}
+		}
+		throw std::length_error{ "No prime bucket count is that large.\n" };
+	}
+
+	static size_t grow(size_t count) { return roundUp(count + 1U); }
+};
+
+
+/**
+ * Bucket count fixed at compile time, for tables whose size is known up
+ * front. The count is a constant of the type, so the index h % N compiles
+ * to multiplications and shifts, and the index takes no space.
+ *
+ * HashMap throws std::length_error when a fixed table goes over its load
+ * factor, and HashMapInternalChaining lets its chains grow longer instead.
+ *
+ * @param N Number of buckets
+ * @return FixedIndex
+ */
+template <size_t N>
+class FixedIndex {
+	static_assert(N != 0U, "FixedIndex needs at least one bucket");
+
+public:
+	explicit FixedIndex(size_t = N) {}
+
+	/**
+	* Gets the bucket of a hash, h % N.
+	*/
+	size_t operator()(uint64_t h) const { return static_cast<size_t>(h % N); }
+
+	static constexpr size_t roundUp(size_t) { return N; }
+
+	static constexpr size_t grow(size_t) { return N; }
+};
+
+#endif // !BUCKET_INDEX_HPP
@@ -0,0 +1,437 @@
+#ifndef CONCURRENT_HASH_MAP_HPP
+#define CONCURRENT_HASH_MAP_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "NodePool.hpp"
+
+/**
+ * Hash table with separate chaining that can be shared between threads.
+ * The buckets are guarded by a fixed set of striped locks. The bucket
+ * count is always a multiple of the number of stripes, so the stripe of
+ * a key only depends on its hash and a key keeps its lock while the table
+ * grows. Each stripe also owns the NodePool of its nodes, so allocating
+ * only needs the lock that is already held.
+ *
+ * Values are never handed out by reference, since another thread could
+ * change them right after. They are read and updated with callbacks
+ * that run while the lock of their stripe is held, which makes
+ * read-modify-write updates such as counters atomic.
+ *
+ * Growing locks every stripe and rebuilds the table at once.
+ *
+ * @param K Type of the entry key
+ * @param T Type of the entry value
+ * @param Hasher Struct with overloaded operator() as with hash function
+ */
+template <class K, class T, class Hasher = std::hash<K>>
+class ConcurrentHashMap {
+public:
+	using Entry = std::pair<const K, T>;
+
+private:
+	/**
+	 * Chain link holding one entry.
+	 */
+	struct Node {
+		Entry entry; // Key value pair
+		Node* next; // Next node of the bucket
+
+		template <class... Args>
+		Node(Args&&... args) : entry(std::forward<Args>(args)...), next{ nullptr } {}
+	};
+
+	/**
+	 * Lock of a set of buckets, on its own cache line so stripes do not contend by sharing one.
+	 */
+	struct alignas(64) Stripe {
+		std::mutex mutex; // Guards the buckets of the stripe and the pool
+		NodePool<Node> pool; // Storage of the nodes of the stripe
+	};
+
+	static constexpr size_t kDefaultStripeCount{ 64U }; // Number of locks of default constructed maps
+	static constexpr size_t kDefaultBucketCount{ 64U }; // Bucket count of default constructed maps
+
+	std::unique_ptr<Stripe[]> m_stripes; // Locks of the buckets, bucket i belongs to stripe i % m_stripeCount
+	size_t m_stripeCount; // Number of stripes
+	std::vector<Node*> m_table; // Chain head of each bucket
+	size_t m_bucketCount; // Number of buckets, only changed while holding every stripe
+	std::atomic<size_t> m_size; // Number of entries in the table
+	Hasher m_hasher; // Hashing struct with overloaded operator()
+	float m_maxLoadFactor; // Maximum ratio of entries to buckets before growing
+
+public:
+	/**
+	 * Default constructor for ConcurrentHashMap.
+	 * Time: O(b + s)
+	 * Space: O(b + s)
+	 *
+	 * @param bucket_count Initial number of buckets, rounded up to a multiple of the stripe count
+	 * @param stripe_count Number of locks
+	 * @return ConcurrentHashMap
+	 */
+	ConcurrentHashMap(size_t bucket_count = kDefaultBucketCount, size_t stripe_count = kDefaultStripeCount) :
+		m_stripes{}, m_stripeCount{ std::max(stripe_count, size_t{ 1U }) }, m_table{}, m_bucketCount{ 0U }, m_size{ 0U }, m_hasher{ Hasher{} }, m_maxLoadFactor{ 1.0F } {
+		m_stripes.reset(new Stripe[m_stripeCount]);
+		m_bucketCount = roundBucketCount(bucket_count);
+		m_table.resize(m_bucketCount);
+	}
+
+	ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+	ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+	~ConcurrentHashMap() { destroyNodes(); }
+
+
+	/**
+	 * Insert a new element in the hash table if no element already has the key.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to insert
+	 * @param  value Value to map to the key
+	 * @return Wether the entry was inserted
+	 */
+	bool insert(const K& key, const T& value) {
+		return upsert(key, value, [](T&) {});
+	}
+
+	/**
+	 * Updates the value of a key, or inserts it with an initial value if it is not in the table.
+	 * The update runs while no other thread can access the entry.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to update
+	 * @param  init Value to insert when the key is not found, the update is not applied to it
+	 * @param  update Unary function that takes a T& to update the value when the key is found
+	 * @return Wether the entry was inserted
+	 */
+	template <class UnaryFunction>
+	bool upsert(const K& key, const T& init, UnaryFunction update);
+
+	/**
+	 * Adds to a counter, starting it at the amount if the key is not in the table.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key of the counter
+	 * @param  amount Amount to add
+	 * @return Wether the counter was inserted
+	 */
+	bool increment(const K& key, const T& amount = T{ 1 }) {
+		return upsert(key, amount, [&amount](T& value) { value += amount; });
+	}
+
+	/**
+	 * Runs a callback on the value of a key, while no other thread can access the entry.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @param  func Unary function that takes a T& or const T&
+	 * @return Wether the key was found
+	 */
+	template <class UnaryFunction>
+	bool visit(const K& key, UnaryFunction func);
+
+	/**
+	 * Copies the value of a key.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @param  [out] value Copy of the value, only written if found
+	 * @return Wether the key was found
+	 */
+	bool find(const K& key, T& value) {
+		return visit(key, [&value](const T& found) { value = found; });
+	}
+
+	/**
+	* Erases an entry with a given key.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param  key Key of the entry to erase
+	* @return Wether the key was found
+	*/
+	bool erase(const K& key);
+
+	/**
+	* Returns the number of entries in the container.
+	* Other threads may change it right after it is read.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @return Container size
+	*/
+	size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+	bool empty() const { return size() == 0U; }
+
+	/**
+	* Gets the number of buckets, which may change as soon as it is read.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @return Bucket count
+	*/
+	size_t bucket_count() const {
+		std::lock_guard<std::mutex> lock{ m_stripes[0].mutex };
+		return m_bucketCount;
+	}
+
+	size_t stripe_count() const { return m_stripeCount; }
+
+	float max_load_factor() const { return m_maxLoadFactor; }
+
+	/**
+	 * Sets the load factor that triggers growing. Not safe to call while other threads use the map.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param ml Maximum average number of entries per bucket
+	 */
+	void max_load_factor(float ml) { m_maxLoadFactor = std::max(ml, 0.0625F); }
+
+	/**
+	 * Makes room for the given number of entries without growing again.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param count Number of entries
+	 */
+	void reserve(size_t count);
+
+	/**
+	* Helper to run a callbach on each element of the hash map.
+	* Every stripe is locked for the whole walk, so it sees a consistent table.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param func Unary function that takes a const std::pair<const K, T>& as parameter
+	*/
+	template <class UnaryFunction>
+	void forEach(UnaryFunction func) const;
+
+private:
+	/**
+	 * Locks every stripe for the lifetime of the object, in index order so it cannot deadlock with another one.
+	 */
+	class LockAll {
+		const ConcurrentHashMap& m_map;
+
+	public:
+		explicit LockAll(const ConcurrentHashMap& map) : m_map{ map } {
+			for (size_t i{ 0U }; i < m_map.m_stripeCount; ++i) {
+				m_map.m_stripes[i].mutex.lock();
+			}
+		}
+
+		~LockAll() {
+			for (size_t i{ m_map.m_stripeCount }; i != 0U; --i) {
+				m_map.m_stripes[i - 1U].mutex.unlock();
+			}
+		}
+
+		LockAll(const LockAll&) = delete;
+		LockAll& operator=(const LockAll&) = delete;
+	};
+
+	uint64_t hash(const K& key) const { return static_cast<uint64_t>(m_hasher(key)); }
+
+	Stripe& stripeOf(uint64_t h) const { return m_stripes[h % m_stripeCount]; }
+
+	/**
+	 * Rounds a bucket count up to a multiple of the stripe count.
+	 */
+	size_t roundBucketCount(size_t count) const {
+		return std::max((count + m_stripeCount - 1U) / m_stripeCount, size_t{ 1U }) * m_stripeCount;
+	}
+
+	/**
+	 * Number of entries allowed for a bucket count before growing.
+	 */
+	size_t maxSize(size_t bucket_count) const {
+		return static_cast<size_t>(bucket_count * static_cast<double>(m_maxLoadFactor));
+	}
+
+	/**
+	 * Finds the link to the node of a key. The stripe of the key must be locked.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @param  h Full hash of the key
+	 * @return Link pointing to the node with the key, or the end link of its bucket if not found
+	 */
+	Node** findLink(const K& key, uint64_t h) {
+		Node** link{ &m_table[h % m_bucketCount] };
+		while (*link != nullptr && !((*link)->entry.first == key)) {
+			link = &(*link)->next;
+		}
+		return link;
+	}
+
+	/**
+	 * Rebuilds the table with more buckets, unless another thread already did.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param seenBucketCount Bucket count when the need to grow was seen
+	 */
+	void grow(size_t seenBucketCount);
+
+	/**
+	 * Moves every node to a table with the given number of buckets. Every stripe must be locked.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param count New bucket count, a multiple of the stripe count
+	 */
+	void rebuild(size_t count);
+
+	/**
+	 * Runs the destructor of every node, leaving their storage in the pools.
+	 * Time: O(n)
+	 * Space: O(1)
+	 */
+	void destroyNodes() {
+		for (Node* node : m_table) {
+			while (node != nullptr) {
+				Node* next{ node->next };
+				node->~Node();
+				node = next;
+			}
+		}
+	}
+};
+
+template<class K, class T, class Hasher>
+template<class UnaryFunction>
+inline bool ConcurrentHashMap<K, T, Hasher>::upsert(const K& key, const T& init, UnaryFunction update) {
+	const uint64_t h{ hash(key) };
+	size_t bucketCount{ 0U };
+	{
+		Stripe& stripe{ stripeOf(h) };
+		std::lock_guard<std::mutex> lock{ stripe.mutex };
+
+		// Update the value in place if the key is already there
+		Node** link{ findLink(key, h) };
+		if (*link != nullptr) {
+			update((*link)->entry.second);
+			return false;
+		}
+
+		// Append the key to its bucket
+		*link = new (stripe.pool.allocate()) Node(key, init);
+		bucketCount = m_bucketCount;
+	}
+
+	// Grow once the lock is released, other threads may have grown already
+	if (m_size.fetch_add(1U, std::memory_order_relaxed) + 1U > maxSize(bucketCount)) {
+		grow(bucketCount);
+	}
+	return true;
+}
+
+template<class K, class T, class Hasher>
+template<class UnaryFunction>
+inline bool ConcurrentHashMap<K, T, Hasher>::visit(const K& key, UnaryFunction func) {
+	const uint64_t h{ hash(key) };
+	std::lock_guard<std::mutex> lock{ stripeOf(h).mutex };
+	Node* node{ *findLink(key, h) };
+	if (node == nullptr) {
+		return false;
+	}
+	func(node->entry.second);
+	return true;
+}
+
+template<class K, class T, class Hasher>
+inline bool ConcurrentHashMap<K, T, Hasher>::erase(const K& key) {
+	const uint64_t h{ hash(key) };
+	Stripe& stripe{ stripeOf(h) };
+	std::lock_guard<std::mutex> lock{ stripe.mutex };
+
+	// Unlink the node and give its storage back to the pool of the stripe
+	Node** link{ findLink(key, h) };
+	Node* node{ *link };
+	if (node == nullptr) {
+		return false;
+	}
+	*link = node->next;
+	node->~Node();
+	stripe.pool.deallocate(node);
+	m_size.fetch_sub(1U, std::memory_order_relaxed);
+	return true;
+}
+
+template<class K, class T, class Hasher>
+inline void ConcurrentHashMap<K, T, Hasher>::reserve(size_t count) {
+	LockAll lock{ *this };
+	if (count > maxSize(m_bucketCount)) {
+		rebuild(roundBucketCount(static_cast<size_t>(std::ceil(count / static_cast<double>(m_maxLoadFactor)))));
+	}
+}
+
+template<class K, class T, class Hasher>
+template<class UnaryFunction>
+inline void ConcurrentHashMap<K, T, Hasher>::forEach(UnaryFunction func) const {
+	LockAll lock{ *this };
+	for (const Node* node : m_table) {
+		for (; node != nullptr; node = node->next) {
+			func(node->entry);
+		}
+	}
+}
+
+template<class K, class T, class Hasher>
+inline void ConcurrentHashMap<K, T, Hasher>::grow(size_t seenBucketCount) {
+	LockAll lock{ *this };
+	if (m_bucketCount != seenBucketCount) {
+		return;
+	}
+
+	// Keep the bucket count a multiple of the stripe count while doubling it
+	rebuild(m_bucketCount * 2U + m_stripeCount);
+}
+
+template<class K, class T, class Hasher>
+inline void ConcurrentHashMap<K, T, Hasher>::rebuild(size_t count) {
+	std::vector<Node*> table(count);
+	std::vector<Node**> tails(count);
+	for (size_t i{ 0U }; i < count; ++i) {
+		tails[i] = &table[i];
+	}
+
+	// Append each node to the end of its new bucket, keeping the order of the chains
+	for (Node* node : m_table) {
+		while (node != nullptr) {
+			Node* next{ node->next };
+			Node**& tail{ tails[hash(node->entry.first) % count] };
+			node->next = nullptr;
+			*tail = node;
+			tail = &node->next;
+			node = next;
+		}
+	}
+
+	m_table.swap(table);
+	m_bucketCount = count;
+}
+
+#endif // !CONCURRENT_HASH_MAP_HPP
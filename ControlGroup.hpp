@@ -0,0 +1,118 @@
+#ifndef CONTROL_GROUP_HPP
+#define CONTROL_GROUP_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONTROL_GROUP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/**
+ * Control byte of an open addressing slot.
+ * Full slots store a 7 bit fingerprint of the key hash (0 to 127),
+ * so empty and deleted slots are the only negative values.
+ */
+using ctrl_t = int8_t;
+
+enum : ctrl_t {
+	kCtrlEmpty = -128, // Never used, terminates probe sequences
+	kCtrlDeleted = -2 // Erased, keeps probe sequences going
+};
+
+
+/**
+ * Window of 16 consecutive control bytes compared all at once.
+ * Uses SSE2 when available and a scalar loop otherwise.
+ *
+ * Every match function returns a bit mask where bit i is set if the
+ * i-th control byte of the window matches.
+ */
+class ControlGroup {
+public:
+	static constexpr unsigned kWidth{ 16U }; // Number of control bytes per group
+
+#ifdef CONTROL_GROUP_SSE2
+	/**
+	 * Loads a group starting at the given control byte.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param ctrl Pointer to the first control byte, with at least kWidth readable bytes
+	 * @return ControlGroup
+	 */
+	explicit ControlGroup(const ctrl_t* ctrl) : m_ctrl{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)) } {}
+
+	uint32_t match(ctrl_t h2) const {
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+	}
+
+	uint32_t matchEmpty() const {
+		return match(kCtrlEmpty);
+	}
+
+	uint32_t matchEmptyOrDeleted() const {
+		// Only empty and deleted slots have the sign bit set
+		return static_cast<uint32_t>(_mm_movemask_epi8(m_ctrl));
+	}
+
+private:
+	__m128i m_ctrl; // Packed control bytes
+#else
+	explicit ControlGroup(const ctrl_t* ctrl) : m_ctrl{ ctrl } {}
+
+	uint32_t match(ctrl_t h2) const {
+		uint32_t mask{ 0U };
+		for (unsigned i{ 0U }; i < kWidth; ++i) {
+			mask |= static_cast<uint32_t>(m_ctrl[i] == h2) << i;
+		}
+		return mask;
+	}
+
+	uint32_t matchEmpty() const {
+		return match(kCtrlEmpty);
+	}
+
+	uint32_t matchEmptyOrDeleted() const {
+		uint32_t mask{ 0U };
+		for (unsigned i{ 0U }; i < kWidth; ++i) {
+			mask |= static_cast<uint32_t>(m_ctrl[i] < 0) << i;
+		}
+		return mask;
+	}
+
+private:
+	const ctrl_t* m_ctrl; // First control byte of the window
+#endif
+
+public:
+	/**
+	 * Gets the position of the lowest set bit of a non zero mask.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param mask Non zero bit mask
+	 * @return Index of the lowest set bit
+	 */
+	static unsigned lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+};
+
+#endif // !CONTROL_GROUP_HPP
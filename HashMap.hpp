@@ -6,54 +6,507 @@
 // TCB1004.500
 // 21/11/2020
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "BucketIndex.hpp"
+#include "ControlGroup.hpp"
+#include "MapStats.hpp"
+
+
+/**
+ * Probing policies for HashMap.
+ * GroupProbing scans 16 control byte fingerprints at once and erases with deleted markers.
+ * RobinHoodProbing keeps the probe distances of a run balanced, so misses stop early,
+ * and erases by shifting the rest of the run back, so no deleted markers pile up.
+ */
+struct GroupProbing {};
+struct RobinHoodProbing {};
+
 
 /**
- * Implementation a hash table of constant size.
+ * Implementation a hash table with open addressing.
+ * Entries are stored inline in a contiguous slot array, and a separate
+ * array of one control byte per slot holds a 7 bit fingerprint of the
+ * key hash, or marks the slot as empty or deleted. Lookups compare the
+ * fingerprints of a whole ControlGroup at once and only compare keys on
+ * fingerprint matches.
+ *
+ * The table grows when the load factor goes over max_load_factor().
+ * Growing is incremental: the old table is kept next to the new one and
+ * every insertion or erasure moves a bounded number of its slots over,
+ * while lookups check both tables. Growing invalidates entry pointers.
  *
  * @param T Type of the entry value
  * @param K Type of the entry key
- * @param Size Constant size of the hash table
  * @param Hash Struct with overloaded operator() as with hash function
+ * @param Probing GroupProbing or RobinHoodProbing
+ * @param Stats NoStats, or MapStats to record the probe length and key comparisons of each operation
+ * @param Index Bucket index policy of BucketIndex.hpp, which picks the bucket counts and the home slot of each hash
 */
-template <class K, class T, class Hasher = std::hash<K>>
-class HashMap {
+template <class K, class T, class Hasher = std::hash<K>, class Probing = GroupProbing, class Stats = NoStats, class Index = ModuloIndex>
+class HashMap : private Stats {
+public:
 	using Entry = std::pair<const K, T>;
-	using EntryUPtr = std::unique_ptr<Entry>;
-	
-	std::vector<EntryUPtr> m_table; // Associative table container for key value pairs
+
+	static constexpr size_t npos{ static_cast<size_t>(-1) }; // Slot index meaning no slot
+
+private:
+	using Slot = typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type;
+
+	static constexpr size_t kMirrored{ ControlGroup::kWidth - 1U }; // Control bytes cloned after the end so groups can wrap around
+	static constexpr size_t kMigrateStep{ ControlGroup::kWidth }; // Old slots moved per insertion or erasure while growing
+	static constexpr size_t kDefaultBucketCount{ 15U }; // Bucket count of default constructed maps
+
+	static constexpr bool kRobinHood{ std::is_same<Probing, RobinHoodProbing>::value };
+	static constexpr uint32_t kMaxDistance{ 0xFFFFU }; // Largest probe distance a Robin Hood slot can record
+
+	/**
+	 * Slot and control byte storage of one open addressing table.
+	 */
+	struct Table {
+		std::unique_ptr<Slot[]> slots; // Inline storage for the entries, only constructed where the slot is full
+		std::unique_ptr<ctrl_t[]> ctrl; // Control byte per slot, followed by the clones of the first kMirrored ones
+		std::unique_ptr<uint16_t[]> dist; // Distance of each full slot from its home slot, only used by Robin Hood probing
+		size_t bucketCount; // Number of slots
+		size_t size; // Number of full slots
+		size_t deleted; // Number of deleted slots
+		Index index; // Home slot of each hash
+
+		Table() : slots{}, ctrl{}, dist{}, bucketCount{ 0U }, size{ 0U }, deleted{ 0U }, index{} {}
+
+		explicit Table(size_t bucket_count) : slots{ new Slot[bucket_count] }, ctrl{ new ctrl_t[bucket_count + kMirrored] }, dist{ kRobinHood ? new uint16_t[bucket_count] : nullptr }, bucketCount{ bucket_count }, size{ 0U }, deleted{ 0U }, index{ bucket_count } {
+			std::fill(ctrl.get(), ctrl.get() + bucketCount + kMirrored, ctrl_t{ kCtrlEmpty });
+		}
+
+		Table(const Table& copy) : Table{} {
+			if (copy.ctrl == nullptr) {
+				return;
+			}
+			Table table{ copy.bucketCount };
+			std::copy(copy.ctrl.get(), copy.ctrl.get() + copy.bucketCount + kMirrored, table.ctrl.get());
+			if (kRobinHood) {
+				std::copy(copy.dist.get(), copy.dist.get() + copy.bucketCount, table.dist.get());
+			}
+			for (size_t i{ 0U }; i < copy.bucketCount; ++i) {
+				if (isFull(copy.ctrl[i])) {
+					new (&table.slots[i]) Entry(*copy.slot(i));
+					table.size++;
+				}
+			}
+			table.deleted = copy.deleted;
+			swap(table);
+		}
+
+		Table(Table&& other) noexcept : Table{} { swap(other); }
+
+		Table& operator=(Table other) noexcept {
+			swap(other);
+			return *this;
+		}
+
+		~Table() { destroyEntries(); }
+
+		void swap(Table& other) noexcept {
+			using std::swap;
+			swap(slots, other.slots);
+			swap(ctrl, other.ctrl);
+			swap(dist, other.dist);
+			swap(bucketCount, other.bucketCount);
+			swap(size, other.size);
+			swap(deleted, other.deleted);
+			swap(index, other.index);
+		}
+
+		Entry* slot(size_t i) { return reinterpret_cast<Entry*>(&slots[i]); }
+		const Entry* slot(size_t i) const { return reinterpret_cast<const Entry*>(&slots[i]); }
+
+		size_t next(size_t i) const { return (i + 1U == bucketCount ? 0U : i + 1U); }
+		size_t prev(size_t i) const { return (i == 0U ? bucketCount - 1U : i - 1U); }
+
+		/**
+		 * Wraps a position past the end of the table back to its start.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param i Position less than twice the table size, or any position on tables smaller than a group
+		 * @return Slot index
+		 */
+		size_t wrap(size_t i) const {
+			return (i < bucketCount ? i : (i - bucketCount < bucketCount ? i - bucketCount : i % bucketCount));
+		}
+
+		/**
+		 * Sets the control byte of a slot and of its clones.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param i Index of the slot
+		 * @param c New control byte
+		 */
+		void setCtrl(size_t i, ctrl_t c) {
+			ctrl[i] = c;
+			for (size_t j{ i }; j < kMirrored; j += bucketCount) {
+				ctrl[bucketCount + j] = c;
+			}
+		}
+
+		/**
+		 * Finds the slot of the given key.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param  key Key of the entry to look for
+		 * @param  h Full hash of the key
+		 * @param [out] found Wether the returned slot holds the key
+		 * @param [out] probe Counter of the slots or groups visited and of the keys compared
+		 * @return Index of the slot with the key, or of the slot an insertion of the key would take, or npos if there is none
+		 */
+		size_t findNode(const K& key, uint64_t h, bool& found, typename Stats::Probe& probe) const {
+			found = false;
+			if (bucketCount == 0U) {
+				return npos;
+			}
+
+			const ctrl_t h2{ fingerprint(h) };
+			size_t pos{ index(h) };
+
+			if constexpr (kRobinHood) {
+				// Walk the run of the home slot. Entries are sorted by home slot, so once an entry is
+				// closer to its home than the key would be to its own, the key cannot be further ahead
+				for (uint32_t d{ 0U }; ; ++d) {
+					probe.step();
+					if (ctrl[pos] == kCtrlEmpty || dist[pos] < d) {
+						return pos;
+					}
+					if (ctrl[pos] == h2) {
+						probe.compare();
+						if (slot(pos)->first == key) {
+							found = true;
+							return pos;
+						}
+					}
+					pos = next(pos);
+				}
+			}
+			else {
+				// Scan the table one group at a time from the start position, wrapping around the array looking for the key
+				size_t firstFree{ npos };
+				for (size_t probed{ 0U }; probed < bucketCount; probed += ControlGroup::kWidth) {
+					const ControlGroup group{ &ctrl[pos] };
+					probe.step();
+
+					// Only compare the keys whose fingerprint matches
+					for (uint32_t mask{ group.match(h2) }; mask != 0U; mask &= mask - 1U) {
+						const size_t i{ wrap(pos + ControlGroup::lowestBit(mask)) };
+						probe.compare();
+						if (slot(i)->first == key) {
+							// The X marks the spot!
+							found = true;
+							return i;
+						}
+					}
+
+					// Remember the first slot an insertion could use
+					if (firstFree == npos) {
+						const uint32_t freeMask{ group.matchEmptyOrDeleted() };
+						if (freeMask != 0U) {
+							firstFree = wrap(pos + ControlGroup::lowestBit(freeMask));
+						}
+					}
+
+					// An empty slot ends the probe sequence, the key would have been placed before it
+					if (group.matchEmpty() != 0U) {
+						return firstFree;
+					}
+
+					pos = wrap(pos + ControlGroup::kWidth);
+				}
+
+				// Worst case: full iteration
+				return firstFree;
+			}
+		}
+
+		/**
+		 * Constructs the entry of a key that is not in the table.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param hint Slot returned by findNode for the key, or npos to look for it again
+		 * @param h Full hash of the key
+		 * @param args Arguments for the entry constructor
+		 * @return Pointer to the new entry
+		 */
+		template <class... Args>
+		Entry* emplace(size_t hint, uint64_t h, Args&&... args) {
+			const size_t home{ index(h) };
+
+			if constexpr (kRobinHood) {
+				// Skip the entries at least as far from their home as the key would be
+				size_t pos{ hint };
+				uint32_t d{ 0U };
+				if (pos == npos) {
+					for (pos = home; isFull(ctrl[pos]) && dist[pos] >= d; pos = next(pos)) {
+						d++;
+					}
+				}
+				else {
+					d = static_cast<uint32_t>(pos >= home ? pos - home : pos + bucketCount - home);
+				}
+
+				// Find the end of the run, every entry in between moves one slot forward
+				size_t end{ pos };
+				for (; isFull(ctrl[end]); end = next(end)) {
+					if (dist[end] >= kMaxDistance) {
+						throw std::length_error{ "HashMap probe distance overflow" };
+					}
+				}
+				if (d > kMaxDistance) {
+					throw std::length_error{ "HashMap probe distance overflow" };
+				}
+
+				for (; end != pos; end = prev(end)) {
+					const size_t from{ prev(end) };
+					new (&slots[end]) Entry(std::move(*slot(from)));
+					slot(from)->~Entry();
+					setCtrl(end, ctrl[from]);
+					dist[end] = static_cast<uint16_t>(dist[from] + 1U);
+				}
+
+				new (&slots[pos]) Entry(std::forward<Args>(args)...);
+				setCtrl(pos, fingerprint(h));
+				dist[pos] = static_cast<uint16_t>(d);
+				size++;
+				return slot(pos);
+			}
+			else {
+				// Take the first empty or deleted slot of the probe sequence
+				size_t pos{ hint };
+				if (pos == npos) {
+					pos = home;
+					uint32_t freeMask{ ControlGroup{ &ctrl[pos] }.matchEmptyOrDeleted() };
+					while (freeMask == 0U) {
+						pos = wrap(pos + ControlGroup::kWidth);
+						freeMask = ControlGroup{ &ctrl[pos] }.matchEmptyOrDeleted();
+					}
+					pos = wrap(pos + ControlGroup::lowestBit(freeMask));
+				}
+
+				new (&slots[pos]) Entry(std::forward<Args>(args)...);
+				if (ctrl[pos] == kCtrlDeleted) {
+					deleted--;
+				}
+				setCtrl(pos, fingerprint(h));
+				size++;
+				return slot(pos);
+			}
+		}
+
+		/**
+		 * Destroys the entry of a full slot.
+		 * Group probing leaves a marker so the probe sequences that pass through it still work,
+		 * Robin Hood probing shifts the rest of the run one slot back instead.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param i Index of a full slot
+		 */
+		void eraseAt(size_t i) {
+			slot(i)->~Entry();
+			size--;
+
+			if constexpr (kRobinHood) {
+				for (size_t j{ next(i) }; isFull(ctrl[j]) && dist[j] > 0U; i = j, j = next(j)) {
+					new (&slots[i]) Entry(std::move(*slot(j)));
+					slot(j)->~Entry();
+					setCtrl(i, ctrl[j]);
+					dist[i] = static_cast<uint16_t>(dist[j] - 1U);
+				}
+				setCtrl(i, kCtrlEmpty);
+			}
+			else {
+				setCtrl(i, kCtrlDeleted);
+				deleted++;
+			}
+		}
+
+		/**
+		 * Runs the destructor of every entry in the table.
+		 * Time: O(n)
+		 * Space: O(1)
+		 */
+		void destroyEntries() {
+			if (std::is_trivially_destructible<Entry>::value || size == 0U) {
+				return;
+			}
+			for (size_t i{ 0U }; i < bucketCount; ++i) {
+				if (isFull(ctrl[i])) {
+					slot(i)->~Entry();
+				}
+			}
+		}
+
+		/**
+		 * Destroys every entry and marks all the slots as empty.
+		 * Time: O(n)
+		 * Space: O(1)
+		 */
+		void clear() {
+			destroyEntries();
+			if (ctrl != nullptr) {
+				std::fill(ctrl.get(), ctrl.get() + bucketCount + kMirrored, ctrl_t{ kCtrlEmpty });
+			}
+			size = 0U;
+			deleted = 0U;
+		}
+
+		/**
+		 * Takes the fingerprint from the top bits of a multiplicative mix, so it does not depend on the slot index bits.
+		 */
+		static ctrl_t fingerprint(uint64_t h) {
+			return static_cast<ctrl_t>((h * 0xC2B2AE3D27D4EB4FULL) >> 57);
+		}
+	};
+
+	Table m_table; // Table receiving the insertions
+	Table m_oldTable; // Table being migrated into m_table, empty when not growing
+	size_t m_migratePos; // Next slot of m_oldTable to migrate
 	Hasher m_hasher; // Hashing struct with overloaded operator()
-	size_t m_bucketCount; // Number of buckets in the table
-	size_t m_size; // Number of entries in the table
+	float m_maxLoadFactor; // Maximum ratio of used (full or deleted) slots before growing
 
 public:
 	/**
 	 * Default constructor for HastMap.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param bucket_count Initial number of buckets
+	 * @return HashMap
+	 */
+	HashMap(size_t bucket_count = kDefaultBucketCount) : m_table{ Index::roundUp(bucket_count) }, m_oldTable{}, m_migratePos{ 0U }, m_hasher{ Hasher{} }, m_maxLoadFactor{ 0.875F } {}
+
+	/**
+	 * Copy constructor.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @return HashMap
+	 */
+	HashMap(const HashMap& copy) = default;
+
+	/**
+	 * Move constructor. Steals the storage of the other map.
 	 * Time: O(1)
 	 * Space: O(1)
-	 * 
+	 *
 	 * @return HashMap
 	 */
-	HashMap(size_t bucket_count) : m_table{}, m_hasher{ Hasher{} }, m_bucketCount{ bucket_count }, m_size{0U} {
-		m_table.resize(m_bucketCount);
-		m_table.shrink_to_fit();
+	HashMap(HashMap&& other) noexcept : m_table{}, m_oldTable{}, m_migratePos{ 0U }, m_hasher{ Hasher{} }, m_maxLoadFactor{ 0.875F } { swap(other); }
+
+	/**
+	 * Copy and move assignment.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @return Reference to this map
+	 */
+	HashMap& operator=(HashMap other) noexcept {
+		swap(other);
+		return *this;
 	}
 
 
 	/**
 	 * Insert a new element in the hash table if no element already has the key.
-	 * Time: O(1)
+	 * Time: O(1) amortized
 	 * Space: O(1)
 	 *
 	 * @param  key Key to insert
 	 * @param  value Value to map to the key
 	 * @return Pointer to the newly inserted pair OR the previously mapped element
 	 */
-	const std::pair<bool, Entry*> insert(const K& key, const T& value);
-	
-	
+	const std::pair<bool, Entry*> insert(const K& key, const T& value) { return emplaceKey(key, value); }
+
+	/**
+	 * Insert a new element in the hash table if no element already has the key,
+	 * moving the value into it. The value is left untouched if the key was occupied.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to insert
+	 * @param  value Value to move into the entry
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	const std::pair<bool, Entry*> insert(const K& key, T&& value) { return emplaceKey(key, std::move(value)); }
+
+	/**
+	 * Insert a new element moving both the key and the value into it.
+	 * Neither is moved from if the key was occupied.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to move into the entry
+	 * @param  value Value to move into the entry
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	const std::pair<bool, Entry*> emplace(K&& key, T&& value) { return emplaceKey(std::move(key), std::move(value)); }
+
+	/**
+	 * Looks for a key and only if it is not there constructs its value in place from the arguments.
+	 * Takes a single lookup either way.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to insert
+	 * @param  args Arguments for the constructor of the value, none to value initialize it
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	template <class... Args>
+	const std::pair<bool, Entry*> try_emplace(const K& key, Args&&... args) { return emplaceKey(key, std::forward<Args>(args)...); }
+
+	template <class... Args>
+	const std::pair<bool, Entry*> try_emplace(K&& key, Args&&... args) { return emplaceKey(std::move(key), std::forward<Args>(args)...); }
+
+	/**
+	 * Gets the value of a key, value initializing it first if the key is not there.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @return Reference to the value of the key
+	 */
+	T& operator[](const K& key) { return try_emplace(key).second->second; }
+
+	/**
+	 * Updates the value of a key, or inserts it with an initial value if it is not there.
+	 * Takes a single lookup either way.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to update
+	 * @param  init Value to insert when the key is not found, the update is not applied to it
+	 * @param  update Unary function that takes a T& to update the value when the key is found
+	 * @return Pointer to the newly inserted pair OR the updated one
+	 */
+	template <class UnaryFunction>
+	const std::pair<bool, Entry*> upsert(const K& key, const T& init, UnaryFunction update) {
+		auto res{ emplaceKey(key, init) };
+		if (!res.first) {
+			update(res.second->second);
+		}
+		return res;
+	}
+
+
 	/**
 	 * Finds an element on the hash table.
 	 * Time: O(1)
@@ -62,9 +515,11 @@ public:
 	 * @param  key Key to insert
 	 * @return Pointer to the found entry or nullptr if not found
 	 */
-	 Entry* find(const K& key);
+	 Entry* find(const K& key) { return const_cast<Entry*>(static_cast<const HashMap&>(*this).find(key)); }
+
+	 const Entry* find(const K& key) const;
+
 
-	 
 	 /**
 	 * Erases an entry with a given key.
 	 * Time: O(1)
@@ -74,7 +529,7 @@ public:
 	 */
 	 void erase(const K& key);
 
-	 
+
 	 /**
 	 * Returns the number of entries in the container.
 	 * Time: O(1)
@@ -82,9 +537,9 @@ public:
 	 *
 	 * @return Container size
 	 */
-	 size_t size() const { return m_size; }
+	 size_t size() const { return m_table.size + m_oldTable.size; }
+
 
-	 
 	 /**
 	  * Tells if the table is empty.
 	  * Time: O(1)
@@ -92,139 +547,369 @@ public:
 	  *
 	  * @return Wether the table has elements
 	  */
-	 bool empty() const { return m_size == 0U; }
+	 bool empty() const { return size() == 0U; }
 
 	 /**
 	  * Clears the content of the hash map.
-	  * Time: O(1)
+	  * Time: O(n)
 	  * Space: O(1)
 	  *
 	  * @return void
 	  */
 	 void clear() {
 		 m_table.clear();
-		 m_table.resize(m_bucketCount);
+		 m_oldTable = Table{};
+		 m_migratePos = 0U;
 	 }
 
-	 
+
 	 /*
 	  * Gets the number of filled buckets in the container.
 	  * Time: O(1)
 	  * Space: O(1)
-	  * 
+	  *
 	  * @return Number of filled buckets
 	  */
-	 size_t bucket_count() const { return m_bucketCount; }
+	 size_t bucket_count() const { return m_table.bucketCount; }
+
+	 /**
+	  * Gets the ratio of entries to buckets.
+	  * Time: O(1)
+	  * Space: O(1)
+	  *
+	  * @return Load factor
+	  */
+	 float load_factor() const { return (m_table.bucketCount == 0U ? 0.0F : static_cast<float>(size()) / m_table.bucketCount); }
+
+	 float max_load_factor() const { return m_maxLoadFactor; }
+
+	 /**
+	  * Sets the load factor that triggers growing. Deleted slots count as used.
+	  * Time: O(1)
+	  * Space: O(1)
+	  *
+	  * @param ml Maximum load factor, in (0, 1]
+	  */
+	 void max_load_factor(float ml) { m_maxLoadFactor = std::min(std::max(ml, 0.0625F), 1.0F); }
+
+	 /**
+	  * Rebuilds the table right away with at least the given number of buckets,
+	  * finishing any incremental growth in progress.
+	  * Time: O(n)
+	  * Space: O(n)
+	  *
+	  * @param count Minimum number of buckets
+	  */
+	 void rehash(size_t count);
+
+	 /**
+	  * Makes room for the given number of entries without growing again.
+	  * Time: O(n)
+	  * Space: O(n)
+	  *
+	  * @param count Number of entries
+	  */
+	 void reserve(size_t count) {
+		 if (count > maxUsed(m_table.bucketCount)) {
+			 rehash(static_cast<size_t>(std::ceil(count / static_cast<double>(m_maxLoadFactor))));
+		 }
+	 }
+
+	 /**
+	  * Helper to run a callback on each element of the hash map.
+	  * Scans the control bytes sequentially.
+	  * Time: O(n)
+	  * Space: O(1)
+	  *
+	  * @param func Unary function that takes a const std::pair<const K, T>& as parameter
+	  */
+	 template <class UnaryFunction>
+	 void forEach(UnaryFunction func) const {
+		 for (const Table* table : { &m_table, &m_oldTable }) {
+			 for (size_t i{ 0U }; i < table->bucketCount; ++i) {
+				 if (isFull(table->ctrl[i])) {
+					 func(*table->slot(i));
+				 }
+			 }
+		 }
+	 }
+
+	 /**
+	  * Swaps the contents of two maps.
+	  * Time: O(1)
+	  * Space: O(1)
+	  *
+	  * @param other Map to swap with
+	  */
+	 void swap(HashMap& other) noexcept {
+		 using std::swap;
+		 m_table.swap(other.m_table);
+		 m_oldTable.swap(other.m_oldTable);
+		 swap(m_migratePos, other.m_migratePos);
+		 swap(m_hasher, other.m_hasher);
+		 swap(m_maxLoadFactor, other.m_maxLoadFactor);
+		 swap(static_cast<Stats&>(*this), static_cast<Stats&>(other));
+	 }
+
+	 /**
+	  * Scans the tables for their occupancy and for the distance of each entry from its home slot.
+	  * Time: O(b)
+	  * Space: O(1)
+	  *
+	  * @return Shape of the tables
+	  */
+	 TableStats tableStats() const {
+		 TableStats stats{ false };
+		 stats.maps = 1U;
+		 for (const Table* table : { &m_table, &m_oldTable }) {
+			 stats.buckets += table->bucketCount;
+			 stats.entries += table->size;
+			 stats.occupiedBuckets += table->size;
+			 stats.deletedBuckets += table->deleted;
+			 for (size_t i{ 0U }; i < table->bucketCount; ++i) {
+				 if (isFull(table->ctrl[i])) {
+					 const size_t home{ table->index(hash(table->slot(i)->first)) };
+					 stats.addLength(i >= home ? i - home : i + table->bucketCount - home);
+				 }
+			 }
+		 }
+		 return stats;
+	 }
+
+	 /**
+	  * Gets the statistics policy, which holds the operation totals when it records them.
+	  */
+	 const Stats& operationStats() const { return *this; }
+
+	 /**
+	  * Writes the table shape and the operation totals as a JSON object.
+	  * Time: O(b)
+	  * Space: O(1)
+	  *
+	  * @param [out] out Stream to write to
+	  */
+	 void writeStats(std::ostream& out) const { writeStatsJson(out, tableStats(), operationStats(), 4U); }
 
 private:
 	/**
-	 * Generates a container index mapped to the key.
+	 * Generates the full hash of a key.
 	 * Time: O(1)
 	 * Space: O(1)
 	 *
 	 * @param  key Key of the entry to hash
-	 * @return Index of the table mapped to the key
+	 * @return Hash of the key, reduced to a slot index by each table
 	 */
-	size_t hash(const K& key) const;
+	uint64_t hash(const K& key) const;
 
 	/**
-	 * Finds the node element of the given key. 
-	 * Protected helper for other functions
+	 * Inserts a key with a value built from the arguments if the key is not there, with a single lookup.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to forward into the entry
+	 * @param  args Arguments for the constructor of the value
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	template <class KArg, class... Args>
+	const std::pair<bool, Entry*> emplaceKey(KArg&& key, Args&&... args);
+
+	/**
+	 * Finds the entry with the given key in either table.
+	 * Private helper for other functions
 	 * Time: O(1)
 	 * Space: O(1)
 	 *
-	 * @param  key Key of the entry to hash
-	 * @param [out] Node found found at the position
-	 * @return Index of the table mapped to the key
+	 * @param  key Key of the entry to look for
+	 * @param  h Full hash of the key
+	 * @param [out] inOldTable Wether the entry is in m_oldTable rather than m_table
+	 * @param [out] found Wether the key was found
+	 * @param [out] probe Counter of the slots or groups visited and of the keys compared
+	 * @return Index of the slot with the key, or of the slot of m_table where it can be inserted
+	 */
+	size_t findNode(const K& key, uint64_t h, bool& inOldTable, bool& found, typename Stats::Probe& probe) const;
+
+	/**
+	 * Number of used slots allowed in a table before growing.
+	 */
+	size_t maxUsed(size_t bucket_count) const {
+		return static_cast<size_t>(bucket_count * static_cast<double>(m_maxLoadFactor));
+	}
+
+	/**
+	 * Starts moving the entries to a bigger table, or to a table of the same size
+	 * when most of the used slots are deleted ones.
+	 * Time: O(1) amortized
+	 * Space: O(n)
+	 *
+	 * @throw std::length_error If the table has a fixed size and it is full
+	 */
+	void grow();
+
+	/**
+	 * Moves a bounded number of slots of the old table to the new one.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param step Number of old slots to visit
 	 */
-	size_t findNode(const K& key, EntryUPtr*& node);
+	void migrate(size_t step);
+
+	static bool isFull(ctrl_t ctrl) { return ctrl >= 0; }
 
 };
 
-template<class K, class T, class Hasher>
-inline const std::pair<bool, typename HashMap<K, T, Hasher>::Entry*> HashMap<K, T, Hasher>::insert(const K& key, const T& value){
-	EntryUPtr* res{nullptr};
-	size_t i{ findNode(key, res) };
-	
-	// Check if the given position is 
-	if (res != nullptr && *res != nullptr) {
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+template<class KArg, class... Args>
+inline const std::pair<bool, typename HashMap<K, T, Hasher, Probing, Stats, Index>::Entry*> HashMap<K, T, Hasher, Probing, Stats, Index>::emplaceKey(KArg&& key, Args&&... args){
+	const uint64_t h{ hash(key) };
+	bool inOldTable{ false };
+	bool found{ false };
+	typename Stats::Probe probe{};
+	size_t i{ findNode(key, h, inOldTable, found, probe) };
+	Stats::record(MapOperation::Insert, probe);
+
+	// Check if the given position is
+	if (found) {
 		// The key is occupied, return the element
-		return { false, m_table[i].get() };
-		
+		return { false, (inOldTable ? m_oldTable : m_table).slot(i) };
 	}
-	else {
-		// Position was empty, insert
-		m_table[i] = std::make_unique<Entry>(key, value);
-		m_size++;
-		return { true, m_table[i].get() };
+
+	// Make room before inserting, the new table is empty so look for the slot again
+	if (i == npos || m_table.size + m_table.deleted + 1U > maxUsed(m_table.bucketCount)) {
+		grow();
+		i = npos;
 	}
+
+	// Migrating may take the slot found or shift the run of the key, so it goes first
+	if (m_oldTable.slots != nullptr) {
+		migrate(kMigrateStep);
+		i = npos;
+	}
+
+	// Position was empty, construct the entry in place
+	return { true, m_table.emplace(i, h, std::piecewise_construct, std::forward_as_tuple(std::forward<KArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...)) };
 }
 
-template<class K, class T, class Hasher>
-inline typename HashMap<K, T, Hasher>::Entry* HashMap<K, T, Hasher>::find(const K& key){
-	EntryUPtr* res{ nullptr };
-	findNode(key, res);
-	return ((res != nullptr && *res != nullptr) ? res->get() : nullptr);
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline const typename HashMap<K, T, Hasher, Probing, Stats, Index>::Entry* HashMap<K, T, Hasher, Probing, Stats, Index>::find(const K& key) const{
+	bool inOldTable{ false };
+	bool found{ false };
+	typename Stats::Probe probe{};
+	size_t i{ findNode(key, hash(key), inOldTable, found, probe) };
+	Stats::record(MapOperation::Find, probe);
+	return (found ? (inOldTable ? m_oldTable : m_table).slot(i) : nullptr);
 }
 
-template<class K, class T, class Hasher>
-inline void HashMap<K, T, Hasher>::erase(const K& key){
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline void HashMap<K, T, Hasher, Probing, Stats, Index>::erase(const K& key){
 	// Find the node
-	EntryUPtr* res{nullptr};
-	findNode(key, res);
-	
-	// If it is found, delete it
-	if (res != nullptr && *res != nullptr) {
-		m_size--;
-		res->reset();
+	bool inOldTable{ false };
+	bool found{ false };
+	typename Stats::Probe probe{};
+	size_t i{ findNode(key, hash(key), inOldTable, found, probe) };
+	Stats::record(MapOperation::Erase, probe);
+
+	// If it is found, destroy it
+	if (found) {
+		(inOldTable ? m_oldTable : m_table).eraseAt(i);
+		migrate(kMigrateStep);
+	}
+}
+
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline void HashMap<K, T, Hasher, Probing, Stats, Index>::rehash(size_t count){
+	count = Index::roundUp(std::max({ count, static_cast<size_t>(std::ceil(size() / static_cast<double>(m_maxLoadFactor))) + 1U, size_t{ 1U } }));
+
+	// Move every entry to a fresh table at once, the old tables are dropped whole
+	Table table{ count };
+	for (Table* from : { &m_table, &m_oldTable }) {
+		for (size_t i{ 0U }; i < from->bucketCount; ++i) {
+			if (isFull(from->ctrl[i])) {
+				Entry* entry{ from->slot(i) };
+				const uint64_t h{ hash(entry->first) };
+				table.emplace(npos, h, std::move(*entry));
+				entry->~Entry();
+				from->ctrl[i] = kCtrlEmpty;
+			}
+		}
+		from->size = 0U;
 	}
+
+	m_table = std::move(table);
+	m_oldTable = Table{};
+	m_migratePos = 0U;
 }
 
-template<class K, class T, class Hasher>
-inline size_t HashMap<K, T, Hasher>::hash(const K& key) const{
-	return m_hasher(key) % (m_bucketCount -1);
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline uint64_t HashMap<K, T, Hasher, Probing, Stats, Index>::hash(const K& key) const{
+	return static_cast<uint64_t>(m_hasher(key));
 }
 
-template<class K, class T, class Hasher>
-inline size_t HashMap<K, T, Hasher>::findNode(const K& key, EntryUPtr*& node){
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline size_t HashMap<K, T, Hasher, Probing, Stats, Index>::findNode(const K& key, uint64_t h, bool& inOldTable, bool& found, typename Stats::Probe& probe) const{
+	// Keys are only in one of the tables, the newest one gets the insertions
+	inOldTable = false;
+	size_t i{ m_table.findNode(key, h, found, probe) };
+	if (!found && m_oldTable.size != 0U) {
+		size_t j{ m_oldTable.findNode(key, h, found, probe) };
+		if (found) {
+			inOldTable = true;
+			return j;
+		}
+	}
+	return i;
+}
 
-	size_t startPos{ hash(key) };
-	if (m_table[startPos] == nullptr) {
-		// Not found
-		node = nullptr;
-		return startPos;
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline void HashMap<K, T, Hasher, Probing, Stats, Index>::grow(){
+	// A table of fixed size only takes entries up to its load factor, rebuilding in place to clear deleted slots
+	const bool fixed{ m_table.bucketCount != 0U && Index::grow(m_table.bucketCount) == m_table.bucketCount };
+	if (fixed && size() + 1U > maxUsed(m_table.bucketCount)) {
+		throw std::length_error{ "HashMap is full.\n" };
 	}
 
-	// Something found, compare the key to check for match
-	if (m_table[startPos]->first == key) {
-		// The X marks the spot!
-		node =  &m_table[startPos];
-		return startPos;
+	// Growing again before the last migration is done, finish it all at once
+	if (m_oldTable.size != 0U) {
+		rehash(Index::grow(m_table.bucketCount));
+		return;
 	}
 
-	// We got a collision, iterate until you get the key or null
-	// Get the starting position and wrap around the array looking for the key
-	for (size_t i{ 0U }; i < m_bucketCount; ++i) {
-		size_t wrapPos{ (startPos + i) % m_bucketCount };
+	// Keep new tables at most half used, doubling the bucket count as the rest of the container sizes do
+	size_t count{ Index::roundUp(std::max(m_table.bucketCount, size_t{ 1U })) };
+	while ((size() + 1U) * 2U > maxUsed(count) && Index::grow(count) != count) {
+		count = Index::grow(count);
+	}
 
-		if (m_table[wrapPos] == nullptr) {
-			// Not found
-			node = nullptr;
-			return wrapPos;
-		}
+	m_oldTable = std::move(m_table);
+	m_table = Table{ count };
+	m_migratePos = 0U;
+}
 
-		if (m_table[wrapPos]->first == key) {
-			// The mark was off, still got the treasure
-			node = &m_table[wrapPos];
-			return wrapPos;
+template<class K, class T, class Hasher, class Probing, class Stats, class Index>
+inline void HashMap<K, T, Hasher, Probing, Stats, Index>::migrate(size_t step){
+	if (m_oldTable.slots == nullptr) {
+		return;
+	}
+
+	for (; step != 0U && m_migratePos < m_oldTable.bucketCount && m_oldTable.size != 0U; --step) {
+		if (isFull(m_oldTable.ctrl[m_migratePos])) {
+			// Erasing the moved entry keeps the old table searchable. A backward shift may pull
+			// the next entry into the same slot, so only advance once the slot is free
+			Entry* entry{ m_oldTable.slot(m_migratePos) };
+			const uint64_t h{ hash(entry->first) };
+			m_table.emplace(npos, h, std::move(*entry));
+			m_oldTable.eraseAt(m_migratePos);
+		}
+		else {
+			++m_migratePos;
 		}
 	}
 
-	// Worst case: full iteration
-	node = nullptr;
-	return -1;
+	// Release the old table once it is drained
+	if (m_oldTable.size == 0U) {
+		m_oldTable = Table{};
+		m_migratePos = 0U;
+	}
 }
 
 #endif // !HASH_MAP_HPP
-
-
@@ -6,30 +6,82 @@
 // TCB1004.500
 // 21/11/2020
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <vector>
-#include <list>
 #include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "BucketIndex.hpp"
+#include "MapStats.hpp"
+#include "NodePool.hpp"
 
 /**
- * Implementation a hash table of constant size.
+ * Implementation a hash table with separate chaining.
+ * Each bucket is a singly linked chain of nodes, and the nodes come from
+ * a NodePool owned by the map, so inserting does not go to the heap
+ * allocator for every entry and clearing frees whole blocks at once.
+ *
+ * The table grows when the load factor goes over max_load_factor().
+ * Growing is incremental: the old buckets are kept next to the new ones
+ * and every insertion or erasure splices a bounded number of them over,
+ * while lookups check both tables. Entries never move in memory, so
+ * entry pointers stay valid while growing.
+ *
+ * With an InlineCapacity above zero, the first entries are kept in an
+ * array inside the map itself and looked up by linear scan, without
+ * hashing and without allocating the buckets. The map switches to the
+ * hashed table when an insertion would go past the capacity. While in
+ * inline mode, entries move when another one is erased and when the map
+ * switches, so pointers to them only last until the next insertion or
+ * erasure. Both modes iterate in the same order: by bucket index, and by
+ * insertion order within a bucket.
  *
  * @param T Type of the entry value
  * @param K Type of the entry key
- * @param Size Constant size of the hash table
  * @param Hash Struct with overloaded operator() as with hash function
+ * @param InlineCapacity Number of entries stored inline before switching to the hashed table
+ * @param Stats NoStats, or MapStats to record the chain length and key comparisons of each operation
+ * @param Index Bucket index policy of BucketIndex.hpp, which picks the bucket counts and the bucket of each hash
 */
-template <class K, class T, class Hasher = std::hash<K>>
-class HashMapInternalChaining {
+template <class K, class T, class Hasher = std::hash<K>, size_t InlineCapacity = 0U, class Stats = NoStats, class Index = ModuloIndex>
+class HashMapInternalChaining : private Stats {
 public:
 	using Entry = std::pair<const K, T>;
-	using Bucket = std::list<Entry>;
-	using BucketUPtr = std::unique_ptr<Bucket>;
 
 private:
-	std::vector<BucketUPtr> m_table; // Associative table container for key value pairs
+	/**
+	 * Chain link holding one entry.
+	 */
+	struct Node {
+		Entry entry; // Key value pair
+		Node* next; // Next node of the bucket
+
+		template <class... Args>
+		Node(Args&&... args) : entry(std::forward<Args>(args)...), next{ nullptr } {}
+	};
+
+	using Slot = typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type; // Uninitialized storage for one entry
+
+	static constexpr size_t kMigrateStep{ 8U }; // Old buckets moved per insertion or erasure while growing
+	static constexpr size_t kDefaultBucketCount{ 7U }; // Bucket count of default constructed maps
+	static constexpr size_t kInlineSlots{ InlineCapacity == 0U ? 1U : InlineCapacity }; // Size of the inline array, which cannot be empty
+
+	std::vector<Node*> m_table; // Associative table container for key value pairs, one chain head per bucket
+	std::vector<Node*> m_oldTable; // Buckets being migrated into m_table, empty when not growing
+	NodePool<Node> m_pool; // Storage of the nodes
 	Hasher m_hasher; // Hashing struct with overloaded operator()
 	size_t m_bucketCount; // Number of buckets in the table
+	Index m_index; // Bucket of each hash in m_table
+	Index m_oldIndex; // Bucket of each hash in m_oldTable
 	size_t m_size; // Number of entries in the table
+	size_t m_oldSize; // Number of entries still in the old table
+	size_t m_migratePos; // Next bucket of m_oldTable to migrate
+	float m_maxLoadFactor; // Maximum ratio of entries to buckets before growing
+	Slot m_inline[kInlineSlots]; // Entries of the inline mode, in insertion order, the first m_size are constructed
 
 public:
 	/**
@@ -37,45 +89,138 @@ public:
 	 * Time: O(1)
 	 * Space: O(1)
 	 *
+	 * @param bucket_count Initial number of buckets
 	 * @return HashMapInternalChaining
 	 */
-	HashMapInternalChaining(size_t bucket_count) : m_table{}, m_hasher{ Hasher{} }, m_bucketCount{ bucket_count }, m_size{ 0U } {
-		m_table.resize(m_bucketCount);
-		m_table.shrink_to_fit();
+	HashMapInternalChaining(size_t bucket_count = kDefaultBucketCount) : m_table{}, m_oldTable{}, m_pool{}, m_hasher{ Hasher{} }, m_bucketCount{ Index::roundUp(std::max(bucket_count, size_t{ 1U })) }, m_index{ m_bucketCount }, m_oldIndex{}, m_size{ 0U }, m_oldSize{ 0U }, m_migratePos{ 0U }, m_maxLoadFactor{ 1.0F } {
+		if (InlineCapacity == 0U) {
+			m_table.resize(m_bucketCount);
+			m_table.shrink_to_fit();
+		}
 	}
 
 	/**
 	* Copy constructor. Allows for nesting of hash maps as values themselves.
 	* Time: O(n)
 	* Space: O(n)
-	* 
+	*
 	*  @return HashMapInternalChaining
 	*/
-	HashMapInternalChaining(const HashMapInternalChaining& copy) : m_table{}, m_hasher{}, m_bucketCount{ copy.bucket_count() }, m_size{copy.size()}{
-		m_table.resize(m_bucketCount);
-		for (const auto& bucket : copy.m_table) {
-			
-			if (bucket == nullptr) {
-				continue;
-			}
-
-			for (const auto& entry : *bucket) {
-				insert(entry.first, entry.second);
-			}
+	HashMapInternalChaining(const HashMapInternalChaining& copy) : m_table{}, m_oldTable{}, m_pool{}, m_hasher{}, m_bucketCount{ copy.bucket_count() }, m_index{ copy.m_index }, m_oldIndex{}, m_size{ 0U }, m_oldSize{ 0U }, m_migratePos{ 0U }, m_maxLoadFactor{ copy.m_maxLoadFactor } {
+		if (InlineCapacity == 0U || !copy.isInline()) {
+			m_table.resize(m_bucketCount);
 		}
+		copy.forEach([this](const Entry& entry) {
+			insert(entry.first, entry.second);
+		});
+	}
+
+	/**
+	* Move constructor. Steals the buckets and the node pool of the other map.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	*  @return HashMapInternalChaining
+	*/
+	HashMapInternalChaining(HashMapInternalChaining&& other) noexcept : m_table{}, m_oldTable{}, m_pool{}, m_hasher{}, m_bucketCount{ 0U }, m_index{}, m_oldIndex{}, m_size{ 0U }, m_oldSize{ 0U }, m_migratePos{ 0U }, m_maxLoadFactor{ 1.0F } {
+		swap(other);
 	}
 
+	/**
+	* Copy and move assignment.
+	* Time: O(n)
+	* Space: O(n)
+	*
+	*  @return Reference to this map
+	*/
+	HashMapInternalChaining& operator=(HashMapInternalChaining other) noexcept {
+		swap(other);
+		return *this;
+	}
+
+	~HashMapInternalChaining() { destroyNodes(); }
+
 
 	/**
 	 * Insert a new element in the hash table if no element already has the key.
-	 * Time: O(1)
+	 * Time: O(1) amortized
 	 * Space: O(1)
 	 *
 	 * @param  key Key to insert
 	 * @param  value Value to map to the key
 	 * @return Pointer to the newly inserted pair OR the previously mapped element
 	 */
-	const std::pair<bool, Entry*> insert(const K& key, const T& value);
+	const std::pair<bool, Entry*> insert(const K& key, const T& value) { return emplaceKey(key, value); }
+
+	/**
+	 * Insert a new element in the hash table if no element already has the key,
+	 * moving the value into it. The value is left untouched if the key was occupied.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to insert
+	 * @param  value Value to move into the entry
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	const std::pair<bool, Entry*> insert(const K& key, T&& value) { return emplaceKey(key, std::move(value)); }
+
+	/**
+	 * Insert a new element moving both the key and the value into it.
+	 * Neither is moved from if the key was occupied.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to move into the entry
+	 * @param  value Value to move into the entry
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	const std::pair<bool, Entry*> emplace(K&& key, T&& value) { return emplaceKey(std::move(key), std::move(value)); }
+
+	/**
+	 * Looks for a key and only if it is not there constructs its value in place from the arguments.
+	 * Takes a single lookup either way.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to insert
+	 * @param  args Arguments for the constructor of the value, none to value initialize it
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	template <class... Args>
+	const std::pair<bool, Entry*> try_emplace(const K& key, Args&&... args) { return emplaceKey(key, std::forward<Args>(args)...); }
+
+	template <class... Args>
+	const std::pair<bool, Entry*> try_emplace(K&& key, Args&&... args) { return emplaceKey(std::move(key), std::forward<Args>(args)...); }
+
+	/**
+	 * Gets the value of a key, value initializing it first if the key is not there.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @return Reference to the value of the key
+	 */
+	T& operator[](const K& key) { return try_emplace(key).second->second; }
+
+	/**
+	 * Updates the value of a key, or inserts it with an initial value if it is not there.
+	 * Takes a single lookup either way.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to update
+	 * @param  init Value to insert when the key is not found, the update is not applied to it
+	 * @param  update Unary function that takes a T& to update the value when the key is found
+	 * @return Pointer to the newly inserted pair OR the updated one
+	 */
+	template <class UnaryFunction>
+	const std::pair<bool, Entry*> upsert(const K& key, const T& init, UnaryFunction update) {
+		auto res{ emplaceKey(key, init) };
+		if (!res.first) {
+			update(res.second->second);
+		}
+		return res;
+	}
 
 
 	/**
@@ -86,7 +231,9 @@ public:
 	 * @param  key Key to insert
 	 * @return Pointer to the found entry or nullptr if not found
 	 */
-	Entry* find(const K& key);
+	Entry* find(const K& key) { return const_cast<Entry*>(static_cast<const HashMapInternalChaining&>(*this).find(key)); }
+
+	const Entry* find(const K& key) const;
 
 
 	/**
@@ -106,7 +253,7 @@ public:
 	*
 	* @return Container size
 	*/
-	size_t size() const { return m_size; }
+	size_t size() const { return m_size + m_oldSize; }
 
 
 	/**
@@ -116,19 +263,32 @@ public:
 	 *
 	 * @return Wether the table has elements
 	 */
-	bool empty() const { return m_size == 0U; }
+	bool empty() const { return size() == 0U; }
 
 
 	 /**
-	  * Clears the content of the hash map.
-	  * Time: O(1)
+	  * Clears the content of the hash map, releasing the node blocks at once.
+	  * Time: O(n)
 	  * Space: O(1)
 	  *
 	  * @return void
 	  */
 	 void clear() {
-		 m_table.clear();
-		 m_table.resize(m_bucketCount);
+		 destroyNodes();
+		 m_pool.release();
+		 if (InlineCapacity == 0U) {
+			 std::fill(m_table.begin(), m_table.end(), nullptr);
+		 }
+		 else {
+			 // Go back to the inline mode
+			 m_table.clear();
+			 m_table.shrink_to_fit();
+		 }
+		 m_oldTable.clear();
+		 m_oldTable.shrink_to_fit();
+		 m_size = 0U;
+		 m_oldSize = 0U;
+		 m_migratePos = 0U;
 	 }
 
 
@@ -141,45 +301,315 @@ public:
 	 */
 	size_t bucket_count() const { return m_bucketCount; }
 
+	/**
+	 * Gets the ratio of entries to buckets.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @return Load factor
+	 */
+	float load_factor() const { return (m_bucketCount == 0U ? 0.0F : static_cast<float>(size()) / m_bucketCount); }
+
+	float max_load_factor() const { return m_maxLoadFactor; }
+
+	/**
+	 * Sets the load factor that triggers growing.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param ml Maximum average number of entries per bucket
+	 */
+	void max_load_factor(float ml) { m_maxLoadFactor = std::max(ml, 0.0625F); }
+
+	/**
+	 * Rebuilds the table right away with at least the given number of buckets,
+	 * finishing any incremental growth in progress.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param count Minimum number of buckets
+	 */
+	void rehash(size_t count);
+
+	/**
+	 * Makes room for the given number of entries without growing again.
+	 * Time: O(n)
+	 * Space: O(n)
+	 *
+	 * @param count Number of entries
+	 */
+	void reserve(size_t count) {
+		if (isInline()) {
+			if (count <= InlineCapacity) {
+				return;
+			}
+			upgrade();
+		}
+		if (count > maxSize(m_bucketCount)) {
+			rehash(static_cast<size_t>(std::ceil(count / static_cast<double>(m_maxLoadFactor))));
+		}
+	}
+
 	/**
 	* Helper to run a callbach on each element of the hash map
 	* Time: O(n)
 	* Space: O(1)
-	* 
+	*
 	* @param func Unary function that takes a const std::pair<const K, T>& as parameter
 	*/
 	template <class UnaryFunction>
 	void forEach(UnaryFunction func) const {
-		for (const auto& bucket : m_table) {
-			if (bucket != nullptr) {
-				for (const auto& entry : *bucket) {
-					func(entry);
+		if (isInline()) {
+			// Visit the entries in the order the hashed table would, sorting them by bucket
+			size_t order[kInlineSlots];
+			size_t buckets[kInlineSlots];
+			for (size_t i{ 0U }; i < m_size; ++i) {
+				const size_t bucket{ m_bucketCount == 0U ? 0U : m_index(hash(inlineEntry(i)->first)) };
+				size_t j{ i };
+				for (; j != 0U && buckets[j - 1U] > bucket; --j) {
+					order[j] = order[j - 1U];
+					buckets[j] = buckets[j - 1U];
+				}
+				order[j] = i;
+				buckets[j] = bucket;
+			}
+			for (size_t i{ 0U }; i < m_size; ++i) {
+				func(*inlineEntry(order[i]));
+			}
+			return;
+		}
+
+		for (const auto* table : { &m_table, &m_oldTable }) {
+			for (const Node* node : *table) {
+				for (; node != nullptr; node = node->next) {
+					func(node->entry);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Swaps the contents of two maps.
+	 * Time: O(1), O(InlineCapacity) for maps with inline entries
+	 * Space: O(1)
+	 *
+	 * @param other Map to swap with
+	 */
+	void swap(HashMapInternalChaining& other) noexcept {
+		using std::swap;
+		swapInline(other);
+		swap(m_table, other.m_table);
+		swap(m_oldTable, other.m_oldTable);
+		m_pool.swap(other.m_pool);
+		swap(m_hasher, other.m_hasher);
+		swap(m_bucketCount, other.m_bucketCount);
+		swap(m_index, other.m_index);
+		swap(m_oldIndex, other.m_oldIndex);
+		swap(m_size, other.m_size);
+		swap(m_oldSize, other.m_oldSize);
+		swap(m_migratePos, other.m_migratePos);
+		swap(m_maxLoadFactor, other.m_maxLoadFactor);
+		swap(static_cast<Stats&>(*this), static_cast<Stats&>(other));
+	}
+
+	/**
+	 * Scans the buckets for their occupancy and chain lengths.
+	 * Time: O(b + n)
+	 * Space: O(1)
+	 *
+	 * @return Shape of the table
+	 */
+	TableStats tableStats() const {
+		TableStats stats{ true };
+		stats.maps = 1U;
+		stats.entries = size();
+		if (isInline()) {
+			stats.inlineMaps = 1U;
+			stats.inlineEntries = m_size;
+			return stats;
+		}
+		for (const auto* table : { &m_table, &m_oldTable }) {
+			stats.buckets += table->size();
+			for (const Node* node : *table) {
+				size_t length{ 0U };
+				for (; node != nullptr; node = node->next) {
+					length++;
 				}
+				stats.occupiedBuckets += (length != 0U);
+				stats.addLength(length);
 			}
 		}
+		return stats;
 	}
 
+	/**
+	 * Gets the statistics policy, which holds the operation totals when it records them.
+	 */
+	const Stats& operationStats() const { return *this; }
+
+	/**
+	 * Writes the table shape and the operation totals as a JSON object.
+	 * Time: O(b + n)
+	 * Space: O(1)
+	 *
+	 * @param [out] out Stream to write to
+	 */
+	void writeStats(std::ostream& out) const { writeStatsJson(out, tableStats(), operationStats(), 4U); }
+
 private:
 	/**
-	 * Generates a container index mapped to the key.
+	 * Generates the full hash of a key.
 	 * Time: O(1)
 	 * Space: O(1)
 	 *
 	 * @param  key Key of the entry to hash
-	 * @return Index of the table mapped to the key
+	 * @return Hash of the key, reduced to a bucket index by each table
 	 */
-	size_t hash(const K& key) const;
+	uint64_t hash(const K& key) const;
 
 	/**
-	* Private helper for finding a bucket node in the 
-	* given bucket.
-	* Time: O(n)
-	* Space: O(1)
-	* 
-	* @param bucket Reference to linked list bucket of pair pointers
-	* @return Unique pointer to entry pair or nullptr if not found.
-	*/
-	static typename Bucket::iterator findNodeInBucket(const K& key, Bucket& bucket);
+	 * Tells if the entries are in the inline array instead of the hashed table.
+	 */
+	bool isInline() const { return InlineCapacity != 0U && m_table.empty(); }
+
+	Entry* inlineEntry(size_t i) { return reinterpret_cast<Entry*>(&m_inline[i]); }
+	const Entry* inlineEntry(size_t i) const { return reinterpret_cast<const Entry*>(&m_inline[i]); }
+
+	/**
+	 * Finds the index of a key in the inline array.
+	 * Time: O(InlineCapacity)
+	 * Space: O(1)
+	 *
+	 * @param  key Key to look for
+	 * @param [out] probe Counter of the entries visited and of the keys compared
+	 * @return Index of the entry with the key, or m_size if not found
+	 */
+	size_t findInline(const K& key, typename Stats::Probe& probe) const {
+		size_t i{ 0U };
+		for (; i < m_size; ++i) {
+			probe.step();
+			probe.compare();
+			if (inlineEntry(i)->first == key) {
+				break;
+			}
+		}
+		return i;
+	}
+
+	/**
+	 * Moves the inline entries into the hashed table, inserting them in their order.
+	 * Time: O(InlineCapacity)
+	 * Space: O(b)
+	 */
+	void upgrade();
+
+	/**
+	 * Swaps the inline entries of two maps, the rest of the members are swapped by swap().
+	 * Time: O(InlineCapacity)
+	 * Space: O(1)
+	 *
+	 * @param other Map to swap with
+	 */
+	void swapInline(HashMapInternalChaining& other) noexcept;
+
+	/**
+	 * Appends a node to the table for a key that is not in it, growing first if needed.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  h Full hash of the key
+	 * @param  tail End link of the bucket of m_table for the key
+	 * @param  args Arguments for the entry constructor
+	 * @return Pointer to the new entry
+	 */
+	template <class... Args>
+	Entry* appendNode(uint64_t h, Node** tail, Args&&... args);
+
+	/**
+	 * Inserts a key with a value built from the arguments if the key is not there, with a single lookup.
+	 * Time: O(1) amortized
+	 * Space: O(1)
+	 *
+	 * @param  key Key to forward into the entry
+	 * @param  args Arguments for the constructor of the value
+	 * @return Pointer to the newly inserted pair OR the previously mapped element
+	 */
+	template <class KArg, class... Args>
+	const std::pair<bool, Entry*> emplaceKey(KArg&& key, Args&&... args);
+
+	/**
+	 * Number of entries allowed for a bucket count before growing.
+	 */
+	size_t maxSize(size_t bucket_count) const {
+		return static_cast<size_t>(bucket_count * static_cast<double>(m_maxLoadFactor));
+	}
+
+	/**
+	 * Starts moving the entries to a table with twice the buckets, unless the bucket count is fixed.
+	 * Time: O(1) amortized
+	 * Space: O(n)
+	 */
+	void grow();
+
+	/**
+	 * Splices a bounded number of buckets of the old table into the new one.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param step Number of old buckets to move
+	 */
+	void migrate(size_t step);
+
+	/**
+	 * Moves every node of a chain to the end of its bucket in m_table, keeping their order.
+	 * Time: O(n)
+	 * Space: O(1)
+	 *
+	 * @param node First node of the chain
+	 * @return Number of nodes moved
+	 */
+	size_t spliceChain(Node* node);
+
+	/**
+	 * Gets the last link of a chain, where new nodes are appended.
+	 * Time: O(n)
+	 * Space: O(1)
+	 *
+	 * @param link Link to the first node of the chain
+	 * @return Link holding nullptr at the end of the chain
+	 */
+	static Node** chainEnd(Node** link) {
+		while (*link != nullptr) {
+			link = &(*link)->next;
+		}
+		return link;
+	}
+
+	/**
+	 * Runs the destructor of every entry, leaving the storage of the nodes in the pool.
+	 * Time: O(n)
+	 * Space: O(1)
+	 */
+	void destroyNodes() {
+		if (std::is_trivially_destructible<Entry>::value) {
+			return;
+		}
+		if (isInline()) {
+			for (size_t i{ 0U }; i < m_size; ++i) {
+				inlineEntry(i)->~Entry();
+			}
+			return;
+		}
+		for (auto* table : { &m_table, &m_oldTable }) {
+			for (Node* node : *table) {
+				while (node != nullptr) {
+					Node* next{ node->next };
+					node->~Node();
+					node = next;
+				}
+			}
+		}
+	}
 
 	/**
 	 * Finds the node element of the given key.
@@ -188,10 +618,25 @@ private:
 	 * Space: O(1)
 	 *
 	 * @param  key Key of the entry to hash
-	 * @param [out] bucketPos Bucket index in the table
-	 * @return Pair with result and iteartor of node in bucket
+	 * @param  h Full hash of the key
+	 * @param [out] tail End link of the bucket of m_table for the key, only set if not found
+	 * @param [out] inOldTable Wether the key was found in the old table
+	 * @param [out] probe Counter of the nodes visited and of the keys compared
+	 * @return Link pointing to the node with the key, or nullptr if not found
+	 */
+	Node** findNode(const K& key, uint64_t h, Node**& tail, bool& inOldTable, typename Stats::Probe& probe);
+
+	/**
+	 * Finds the node of the given key without taking links, for const lookups.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param  key Key of the entry to look for
+	 * @param  h Full hash of the key
+	 * @param [out] probe Counter of the nodes visited and of the keys compared
+	 * @return Node with the key, or nullptr if not found
 	 */
-	std::pair<bool, typename Bucket::iterator > findNode(const K& key, size_t& bucketPos);
+	const Node* findNode(const K& key, uint64_t h, typename Stats::Probe& probe) const;
 
 
 	/**
@@ -204,122 +649,321 @@ private:
 	 * @return Ostream reference after the insertion
 	 */
 	friend std::ostream& operator<<(std::ostream& out, const HashMapInternalChaining& hm) {
-		for (const auto& bucket : hm.m_table) {
-			if (bucket == nullptr) {
-				continue;
-			}
-
-			for (const auto& entry : *bucket) {
-				out << entry.first << " : " << entry.second << '\n';
-			}
-
-		}
+		hm.forEach([&out](const Entry& entry) {
+			out << entry.first << " : " << entry.second << '\n';
+		});
 		return out;
 	}
 
 };
 
-template<class K, class T, class Hasher>
-inline const std::pair<bool, typename HashMapInternalChaining<K, T, Hasher>::Entry*> HashMapInternalChaining<K, T, Hasher>::insert(const K& key, const T& value) {
-	// Get the bucket at the given key position
-	BucketUPtr& bucketSlot{ m_table[hash(key)] };
-	
-	// If no bucket is found, create it and isert the element
-	if (bucketSlot == nullptr) {
-		bucketSlot = std::make_unique<Bucket>();
-		bucketSlot->emplace_back(key, value);
-		m_size++;
-		return {true, &bucketSlot->back()};
-	}
-	
-	// The node was full, look for the entry node in the bucket
-	auto nodeIt{findNodeInBucket(key, *bucketSlot)};
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+template<class KArg, class... Args>
+inline const std::pair<bool, typename HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::Entry*> HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::emplaceKey(KArg&& key, Args&&... args) {
+	typename Stats::Probe probe{};
+	if (isInline()) {
+		// Look for the key in the inline entries, appending it if there is room
+		const size_t i{ findInline(key, probe) };
+		if (i < m_size) {
+			Stats::record(MapOperation::Insert, probe);
+			return { false, inlineEntry(i) };
+		}
+		if (m_size < InlineCapacity) {
+			Stats::record(MapOperation::Insert, probe);
+			Entry* entry{ new (&m_inline[m_size]) Entry(std::piecewise_construct, std::forward_as_tuple(std::forward<KArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...)) };
+			m_size++;
+			return { true, entry };
+		}
+
+		// No room left, switch to the hashed table, the insertion is recorded once with the work of both lookups
+		upgrade();
+	}
+
+	// Look for the key in the bucket mapped to it
+	const uint64_t h{ hash(key) };
+	Node** tail{ nullptr };
+	bool inOldTable{ false };
+	Node** link{ findNode(key, h, tail, inOldTable, probe) };
+	Stats::record(MapOperation::Insert, probe);
 
 	// Check the result of the lookup
-	if (nodeIt != bucketSlot->end()) {
+	if (link != nullptr) {
 		// The key was occupied
-		return {false, &*nodeIt};
+		return { false, &(*link)->entry };
 	}
-	else {
-		// The bucket did not container the key, emplace it
-		bucketSlot->emplace_back(key, value);
-		m_size++;
-		return { true, &bucketSlot->back() };
+
+	// The bucket did not container the key, append it
+	return { true, appendNode(h, tail, std::piecewise_construct, std::forward_as_tuple(std::forward<KArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...)) };
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+template<class... Args>
+inline typename HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::Entry* HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::appendNode(uint64_t h, Node** tail, Args&&... args) {
+	// Make room before inserting, the bucket of the key changes with the bucket count
+	if (size() + 1U > maxSize(m_bucketCount)) {
+		grow();
+		tail = chainEnd(&m_table[m_index(h)]);
 	}
 
+	Node* node{ new (m_pool.allocate()) Node(std::forward<Args>(args)...) };
+	*tail = node;
+	m_size++;
+	migrate(kMigrateStep);
+	return &node->entry;
 }
 
-template<class K, class T, class Hasher>
-inline typename HashMapInternalChaining<K, T, Hasher>::Entry* HashMapInternalChaining<K, T, Hasher>::find(const K& key) {
-	// Look for the node
-	size_t i{ 0U };
-	auto res{ findNode(key, i) };
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::upgrade() {
+	// Replay the insertions of the inline entries, so the table ends up as if they had always been hashed
+	const size_t count{ m_size };
+	m_size = 0U;
+	if (m_bucketCount == 0U) {
+		m_bucketCount = Index::roundUp(1U);
+		m_index = Index{ m_bucketCount };
+	}
+	m_table.resize(m_bucketCount);
+	for (size_t i{ 0U }; i < count; ++i) {
+		Entry* entry{ inlineEntry(i) };
+		const uint64_t h{ hash(entry->first) };
+		appendNode(h, chainEnd(&m_table[m_index(h)]), std::move(*entry));
+		entry->~Entry();
+	}
+}
 
-	// If the bucket does not exist, or the bucket does not contain the key
-	if (!res.first) {
-		// Return nothing
-		return nullptr;
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::swapInline(HashMapInternalChaining& other) noexcept {
+	const size_t count{ isInline() ? m_size : 0U };
+	const size_t otherCount{ other.isInline() ? other.m_size : 0U };
+	for (size_t i{ 0U }; i < std::max(count, otherCount); ++i) {
+		Entry* mine{ inlineEntry(i) };
+		Entry* theirs{ other.inlineEntry(i) };
+		if (i < count && i < otherCount) {
+			Entry moved{ std::move(*mine) };
+			mine->~Entry();
+			new (mine) Entry(std::move(*theirs));
+			theirs->~Entry();
+			new (theirs) Entry(std::move(moved));
+		}
+		else if (i < count) {
+			new (theirs) Entry(std::move(*mine));
+			mine->~Entry();
+		}
+		else {
+			new (mine) Entry(std::move(*theirs));
+			theirs->~Entry();
+		}
 	}
+}
 
-	// The result iterator is valid, return its content
-	return &*res.second;
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline const typename HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::Entry* HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::find(const K& key) const {
+	typename Stats::Probe probe{};
+	if (isInline()) {
+		const size_t i{ findInline(key, probe) };
+		Stats::record(MapOperation::Find, probe);
+		return (i < m_size ? inlineEntry(i) : nullptr);
+	}
+
+	// Look for the node, nullptr if the bucket does not contain the key
+	const Node* node{ findNode(key, hash(key), probe) };
+	Stats::record(MapOperation::Find, probe);
+	return (node != nullptr ? &node->entry : nullptr);
 }
 
-template<class K, class T, class Hasher>
-inline void HashMapInternalChaining<K, T, Hasher>::erase(const K& key) {
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::erase(const K& key) {
+	typename Stats::Probe probe{};
+	if (isInline()) {
+		// Close the gap of the erased entry, keeping the insertion order
+		size_t i{ findInline(key, probe) };
+		Stats::record(MapOperation::Erase, probe);
+		if (i < m_size) {
+			inlineEntry(i)->~Entry();
+			for (++i; i < m_size; ++i) {
+				new (&m_inline[i - 1U]) Entry(std::move(*inlineEntry(i)));
+				inlineEntry(i)->~Entry();
+			}
+			m_size--;
+		}
+		return;
+	}
+
 	// Look for the node
-	size_t bucketPos;
-	auto res{ findNode(key, bucketPos) };
+	Node** tail{ nullptr };
+	bool inOldTable{ false };
+	Node** link{ findNode(key, hash(key), tail, inOldTable, probe) };
+	Stats::record(MapOperation::Erase, probe);
 
 	// Check that the bucket is valid and that the node exists in the bucket
-	if (res.first) {
-		// Erase the node from the bucket
-		m_size--;
-		m_table[bucketPos]->erase(res.second);
+	if (link != nullptr) {
+		// Unlink the node and give its storage back to the pool, counting it on the table it was in
+		Node* node{ *link };
+		*link = node->next;
+		node->~Node();
+		m_pool.deallocate(node);
+		if (inOldTable) {
+			m_oldSize--;
+		}
+		else {
+			m_size--;
+		}
+		migrate(kMigrateStep);
 	}
 }
 
-template<class K, class T, class Hasher>
-inline size_t HashMapInternalChaining<K, T, Hasher>::hash(const K& key) const {
-	return m_hasher(key) % m_bucketCount;
-}
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::rehash(size_t count) {
+	count = Index::roundUp(std::max({ count, static_cast<size_t>(std::ceil(size() / static_cast<double>(m_maxLoadFactor))), size_t{ 1U } }));
+	m_index = Index{ count };
+
+	// Inline entries are not in buckets, only keep the count for when the table is built
+	if (isInline()) {
+		m_bucketCount = count;
+		return;
+	}
 
-template<class K, class T, class Hasher>
-inline typename HashMapInternalChaining<K, T, Hasher>::Bucket::iterator HashMapInternalChaining<K, T, Hasher>::findNodeInBucket(const K& key, Bucket& bucket){
-	// Find the node in the linked list
-	return std::find_if(bucket.begin(), bucket.end(),
-		[&key](const Entry& entry) {
-			return (entry.first == key);
+	// Splice every chain into a fresh table at once
+	std::vector<Node*> table(count);
+	table.swap(m_table);
+	m_bucketCount = count;
+	for (auto* from : { &table, &m_oldTable }) {
+		for (Node* node : *from) {
+			spliceChain(node);
 		}
-	);
+	}
+
+	m_size += m_oldSize;
+	m_oldSize = 0U;
+	m_oldTable.clear();
+	m_oldTable.shrink_to_fit();
+	m_migratePos = 0U;
 }
 
-template<class K, class T, class Hasher>
-inline std::pair<bool , typename HashMapInternalChaining<K, T, Hasher>::Bucket::iterator> HashMapInternalChaining<K, T, Hasher>::findNode(const K& key, size_t& bucketPos) {
-	// Look for the node in the bucket list of the index mapped to the key
-	size_t i{ hash(key) };
-	bucketPos = i;
-	BucketUPtr& bucketPtr{ m_table[i] };
-	
-	
-	if (bucketPtr != nullptr) {
-	
-		// The bucket is valid
-		auto it{ findNodeInBucket(key, *bucketPtr) };
-		
-		if (it != bucketPtr->end()) {
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline uint64_t HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::hash(const K& key) const {
+	return static_cast<uint64_t>(m_hasher(key));
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::grow() {
+	// A table of fixed size keeps its buckets, its chains get longer instead
+	const size_t count{ Index::grow(m_bucketCount) };
+	if (count == m_bucketCount) {
+		return;
+	}
+
+	// Growing again before the last migration is done, finish it all at once
+	if (m_oldSize != 0U) {
+		rehash(count);
+		return;
+	}
+
+	// Double the bucket count as the rest of the container sizes do
+	m_oldTable.clear();
+	m_oldTable.swap(m_table);
+	m_oldIndex = m_index;
+	m_oldSize = m_size;
+	m_size = 0U;
+	m_migratePos = 0U;
+	m_bucketCount = count;
+	m_index = Index{ m_bucketCount };
+	m_table.resize(m_bucketCount);
+	m_table.shrink_to_fit();
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline void HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::migrate(size_t step) {
+	for (; step != 0U && m_oldSize != 0U && m_migratePos < m_oldTable.size(); --step, ++m_migratePos) {
+		Node*& bucket{ m_oldTable[m_migratePos] };
+		const size_t count{ spliceChain(bucket) };
+		bucket = nullptr;
+		m_oldSize -= count;
+		m_size += count;
+	}
+
+	// Release the old table once it is drained
+	if (m_oldSize == 0U && !m_oldTable.empty()) {
+		m_oldTable.clear();
+		m_oldTable.shrink_to_fit();
+		m_migratePos = 0U;
+	}
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline size_t HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::spliceChain(Node* node) {
+	size_t count{ 0U };
+	while (node != nullptr) {
+		Node* next{ node->next };
+		node->next = nullptr;
+		*chainEnd(&m_table[m_index(hash(node->entry.first))]) = node;
+		node = next;
+		count++;
+	}
+	return count;
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline typename HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::Node** HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::findNode(const K& key, uint64_t h, Node**& tail, bool& inOldTable, typename Stats::Probe& probe) {
+	// Look for the node in the bucket chain of the index mapped to the key, keys are only in one of the tables
+	inOldTable = false;
+	if (m_bucketCount == 0U) {
+		// Moved from map, the insertion grows it first
+		tail = nullptr;
+		return nullptr;
+	}
+
+	Node** link{ &m_table[m_index(h)] };
+	for (; *link != nullptr; link = &(*link)->next) {
+		probe.step();
+		probe.compare();
+		if ((*link)->entry.first == key) {
 			// The bucket contains the key
-			return { true, it };
+			return link;
 		}
-		else {
-			// The bucket does NOT contain the key
-			return { false, it };
+	}
+	tail = link;
+
+	if (m_oldSize != 0U) {
+		for (Node** oldLink{ &m_oldTable[m_oldIndex(h)] }; *oldLink != nullptr; oldLink = &(*oldLink)->next) {
+			probe.step();
+			probe.compare();
+			if ((*oldLink)->entry.first == key) {
+				// The old bucket contains the key
+				inOldTable = true;
+				return oldLink;
+			}
 		}
+	}
 
+	// The bucket was empty or did NOT contain the key
+	return nullptr;
+}
+
+template<class K, class T, class Hasher, size_t InlineCapacity, class Stats, class Index>
+inline const typename HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::Node* HashMapInternalChaining<K, T, Hasher, InlineCapacity, Stats, Index>::findNode(const K& key, uint64_t h, typename Stats::Probe& probe) const {
+	if (m_bucketCount == 0U) {
+		// Moved from map, it has no buckets
+		return nullptr;
 	}
 
-	// The bucket was empty
-	return { false, typename Bucket::iterator{} };
+	// Keys are only in one of the tables, the old one is empty when not growing
+	for (const Node* node{ m_table[m_index(h)] }; node != nullptr; node = node->next) {
+		probe.step();
+		probe.compare();
+		if (node->entry.first == key) {
+			return node;
+		}
+	}
+	if (m_oldSize != 0U) {
+		for (const Node* node{ m_oldTable[m_oldIndex(h)] }; node != nullptr; node = node->next) {
+			probe.step();
+			probe.compare();
+			if (node->entry.first == key) {
+				return node;
+			}
+		}
+	}
+	return nullptr;
 }
 
-#endif // !HASH_MAP_INTERNAL_CHAINING_HPP
\ No newline at end of file
+#endif // !HASH_MAP_INTERNAL_CHAINING_HPP
@@ -0,0 +1,162 @@
+#ifndef HYPER_LOG_LOG_HPP
+#define HYPER_LOG_LOG_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/**
+ * Sketch estimating the number of distinct keys added to it, using the
+ * HyperLogLog algorithm. The top bits of each key hash pick one of 2^p
+ * registers, which keeps the longest run of leading zeros seen in the
+ * rest of the hash. The standard error of the estimate is 1.04 / sqrt(2^p),
+ * about 3% with 1024 registers, in one byte per register.
+ *
+ * Sketches with the same precision are merged by keeping the highest
+ * register values, which gives the sketch of the union of their keys.
+ *
+ * Keys are given as already mixed 64 bit hashes.
+ */
+class HyperLogLog {
+public:
+	static constexpr unsigned kMinPrecision{ 4U }; // Fewest register index bits
+	static constexpr unsigned kMaxPrecision{ 16U }; // Most register index bits
+
+private:
+	unsigned m_precision; // Number of hash bits indexing the registers
+	std::vector<uint8_t> m_registers; // Longest run of leading zeros plus one of each register
+
+	/**
+	* Counts the leading zero bits of a word.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param x Non zero word
+	* @return Number of zero bits above the highest set bit
+	*/
+	static unsigned leadingZeros(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanReverse64(&index, x);
+		return 63U - static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<unsigned long>(x >> 32))) {
+			return 31U - static_cast<unsigned>(index);
+		}
+		_BitScanReverse(&index, static_cast<unsigned long>(x));
+		return 63U - static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+	}
+
+public:
+	/**
+	* Constructor of the sketch.
+	* Time: O(2^p)
+	* Space: O(2^p)
+	*
+	* @param precision Number of hash bits indexing the registers, from kMinPrecision to kMaxPrecision
+	*/
+	explicit HyperLogLog(unsigned precision) : m_precision{ std::min(std::max(precision, kMinPrecision), kMaxPrecision) }, m_registers(size_t{ 1U } << m_precision, 0U) {}
+
+	/**
+	* Adds a key to the sketch.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param hash Mixed 64 bit hash of the key
+	*/
+	void add(uint64_t hash) {
+		const size_t index{ static_cast<size_t>(hash >> (64U - m_precision)) };
+
+		// The bit below the remaining ones stops the run, so it is at most 64 - p + 1
+		const uint64_t rest{ (hash << m_precision) | (uint64_t{ 1U } << (m_precision - 1U)) };
+		const uint8_t rank{ static_cast<uint8_t>(leadingZeros(rest) + 1U) };
+		if (rank > m_registers[index]) {
+			m_registers[index] = rank;
+		}
+	}
+
+	/**
+	* Adds the keys of another sketch.
+	* Time: O(2^p)
+	* Space: O(1)
+	*
+	* @param other Sketch to add, with the same precision
+	* @throw std::invalid_argument if the precisions differ
+	*/
+	void merge(const HyperLogLog& other) {
+		if (other.m_precision != m_precision) {
+			throw std::invalid_argument{ "HyperLogLog sketches with different precision cannot be merged" };
+		}
+		for (size_t i{ 0U }; i < m_registers.size(); ++i) {
+			m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+		}
+	}
+
+	/**
+	* Estimates the number of distinct keys added.
+	* Small counts, which leave registers empty, are estimated by linear counting instead.
+	* Time: O(2^p)
+	* Space: O(1)
+	*
+	* @return Estimated number of distinct keys
+	*/
+	double estimate() const {
+		const double m{ static_cast<double>(m_registers.size()) };
+		double sum{ 0.0 };
+		size_t zeros{ 0U };
+		for (uint8_t reg : m_registers) {
+			sum += std::ldexp(1.0, -static_cast<int>(reg));
+			zeros += (reg == 0U);
+		}
+
+		// Bias correction constant of the harmonic mean
+		double alpha{ 0.7213 / (1.0 + 1.079 / m) };
+		if (m_registers.size() == 16U) {
+			alpha = 0.673;
+		}
+		else if (m_registers.size() == 32U) {
+			alpha = 0.697;
+		}
+		else if (m_registers.size() == 64U) {
+			alpha = 0.709;
+		}
+
+		const double raw{ alpha * m * m / sum };
+		if (raw <= 2.5 * m && zeros != 0U) {
+			return m * std::log(m / static_cast<double>(zeros));
+		}
+		return raw;
+	}
+
+	/**
+	* Empties the sketch.
+	* Time: O(2^p)
+	* Space: O(1)
+	*/
+	void clear() { std::fill(m_registers.begin(), m_registers.end(), uint8_t{ 0U }); }
+
+	unsigned precision() const { return m_precision; }
+
+	/**
+	* Gets the number of bytes of the registers.
+	*/
+	size_t byteSize() const { return m_registers.size(); }
+};
+
+#endif // !HYPER_LOG_LOG_HPP
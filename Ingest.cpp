@@ -0,0 +1,480 @@
+#include "Ingest.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "fileio.hpp"
+#include "LogParser.hpp"
+
+namespace {
+	// Number of malformed lines reported one by one before only counting them
+	const size_t MAX_REPORTED_MALFORMED_LINES{ 10U };
+
+	// Smallest chunk worth a thread of its own
+	const size_t MIN_CHUNK_SIZE{ 1U << 16 };
+
+	/**
+	 * Line that did not parse, numbered from the start of its chunk.
+	 */
+	struct MalformedLine {
+		size_t lineNumber;
+		std::string_view line;
+	};
+
+	/**
+	 * Lines of the part of the log ingested by one thread.
+	 */
+	struct ChunkLines {
+		std::string_view text; // Lines of the chunk
+		std::vector<MalformedLine> malformed; // First malformed lines of the chunk
+		size_t lines; // Number of lines of the chunk
+		size_t malformedLines; // Number of malformed lines of the chunk
+
+		explicit ChunkLines(std::string_view t_text) : text{ t_text }, malformed{}, lines{ 0U }, malformedLines{ 0U } {}
+	};
+
+	/**
+	* Parses each line of a chunk, skipping and recording the malformed ones.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param [out] chunk Lines to parse, their counts are updated
+	* @param func Function taking the const LogRecord& of each line, returning false if the line is malformed anyway
+	*/
+	template <class RecordFunction>
+	void forEachRecord(ChunkLines& chunk, RecordFunction func) {
+		LogRecord record;
+		fio::forEachLine(chunk.text, [&](std::string_view line) {
+			++chunk.lines;
+
+			// Parse the line in place, skipping it if it does not have a valid address
+			if (!parseLogLine(line, record) || !func(static_cast<const LogRecord&>(record))) {
+				if (++chunk.malformedLines <= MAX_REPORTED_MALFORMED_LINES) {
+					chunk.malformed.push_back({ chunk.lines, line });
+				}
+			}
+		});
+	}
+
+	/**
+	* Parses each line of a chunk, skipping and recording the malformed ones.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param [out] chunk Lines to parse, their counts are updated
+	* @param func Function taking the const PackedAddress& access of each line
+	*/
+	template <class AccessFunction>
+	void forEachAccess(ChunkLines& chunk, AccessFunction func) {
+		forEachRecord(chunk, [&func](const LogRecord& record) {
+			func(record.access);
+			return true;
+		});
+	}
+
+	/**
+	* Gets the merge shard of a port. Each shard is merged by one thread.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	size_t shardOf(const Port& port, size_t numShards) {
+		return port.port() % numShards;
+	}
+
+	/**
+	 * Part of the log ingested into a PortMap by one thread, along with what
+	 * the merge needs to replay its insertions in order.
+	 */
+	struct PortChunk {
+		ChunkLines lines; // Lines of the chunk
+		PortMap portMap; // Ports of the chunk
+		std::vector<Port> ports; // Ports in the order they first appear in the chunk
+		std::vector<std::vector<PackedAddress>> accesses; // Accesses of distinct port and ip pairs in the order they first appear, by merge shard
+
+		PortChunk(std::string_view text, size_t numShards) : lines{ text }, portMap{ PORT_MAP_SIZE }, ports{}, accesses(numShards) {}
+
+		/**
+		* Builds the port map of the chunk, recording the order in which ports and ip pairs first appear.
+		* Time: O(n)
+		* Space: O(m)
+		*/
+		void ingest() {
+			const size_t numShards{ accesses.size() };
+			forEachAccess(lines, [this, numShards](const PackedAddress& access) {
+				auto entry{ getIpAndPortFromAccess(access) };
+
+				// Get the port and ip from the entry
+				Port& port{ entry.first };
+				Ip& ip{ entry.second };
+
+				// Get the ip map of the port, creating it empty the first time the port is seen
+				auto portRes{ portMap.try_emplace(port) };
+				if (portRes.first) {
+					ports.push_back(port);
+				}
+				IpMap& ipMap{ portRes.second->second };
+
+				// Count the access of the ip, starting at one the first time the ip is seen on the port
+				auto ipRes{ ipMap.upsert(ip, 1U, [](unsigned& count) { count++; }) };
+				if (ipRes.first) {
+					accesses[shardOf(port, numShards)].push_back(access);
+				}
+
+				// Increment the number of total connections
+				ipMap.incNumConnections();
+			});
+		}
+	};
+
+	/**
+	 * Lines appended to a followed log, added straight to its port map.
+	 */
+	struct AppendChunk {
+		ChunkLines lines; // New lines
+		PortMap& portMap; // Map to add the counts to
+		DirtyPorts& dirtyPorts; // Ports whose counts changed
+
+		AppendChunk(std::string_view text, PortMap& t_portMap, DirtyPorts& t_dirtyPorts) : lines{ text }, portMap{ t_portMap }, dirtyPorts{ t_dirtyPorts } {}
+
+		void ingest() {
+			forEachAccess(lines, [this](const PackedAddress& access) {
+				auto entry{ getIpAndPortFromAccess(access) };
+				IpMap& ipMap{ portMap.try_emplace(entry.first).second->second };
+				ipMap.upsert(entry.second, 1U, [](unsigned& count) { count++; });
+				ipMap.incNumConnections();
+				dirtyPorts.mark(entry.first);
+			});
+		}
+	};
+
+	/**
+	 * Part of the log ingested into a FlatNetMap by one thread.
+	 */
+	struct FlatChunk {
+		ChunkLines lines; // Lines of the chunk
+		FlatNetMap netMap; // Pair counts of the chunk
+
+		FlatChunk(std::string_view text, size_t) : lines{ text }, netMap{} {}
+
+		void ingest() {
+			forEachAccess(lines, [this](const PackedAddress& access) { netMap.add(access); });
+		}
+	};
+
+	/**
+	 * Part of the log summarized into a HeavyHitters by one thread.
+	 */
+	struct HeavyChunk {
+		ChunkLines lines; // Lines of the chunk
+		HeavyHitters summary; // Heavy hitters of the chunk
+
+		HeavyChunk(std::string_view text, size_t, const HeavyHitters& empty) : lines{ text }, summary{ empty } {}
+
+		void ingest() {
+			forEachAccess(lines, [this](const PackedAddress& access) { summary.add(access); });
+		}
+	};
+
+	/**
+	 * Part of the log counted into time windows by one thread. Lines without a valid timestamp are malformed.
+	 */
+	struct WindowChunk {
+		ChunkLines lines; // Lines of the chunk
+		TimeWindows windows; // Counts of the chunk
+
+		WindowChunk(std::string_view text, size_t, const TimeWindows& like) : lines{ text }, windows{ like.slotSeconds(), like.slotCount() } {}
+
+		void ingest() {
+			forEachRecord(lines, [this](const LogRecord& record) {
+				uint32_t time;
+				if (!parseTimestamp(record.timestamp, time)) {
+					return false;
+				}
+				windows.add(time, record.access);
+				return true;
+			});
+		}
+	};
+
+	/**
+	 * Part of the log counted by failure reason by one thread.
+	 */
+	struct ReasonChunk {
+		ChunkLines lines; // Lines of the chunk
+		ReasonStats reasons; // Counts of the chunk
+
+		ReasonChunk(std::string_view text, size_t) : lines{ text }, reasons{} {}
+
+		void ingest() {
+			forEachRecord(lines, [this](const LogRecord& record) {
+				reasons.add(record.access, record.message);
+				return true;
+			});
+		}
+	};
+
+	/**
+	 * Part of the log counted into prefix tries by one thread.
+	 */
+	struct SubnetChunk {
+		ChunkLines lines; // Lines of the chunk
+		SubnetMap subnets; // Tries of the chunk
+
+		SubnetChunk(std::string_view text, size_t, const SubnetMap& like) : lines{ text }, subnets{ like.blocklist() } {}
+
+		/**
+		* Counts the accesses of the chunk sorted by port and ip, so each pair is added once with its count
+		* and each trie is filled in address order. Adding them in log order jumps between the tries of
+		* every port and misses the cache at most nodes.
+		* Time: O(n log n)
+		* Space: O(n)
+		*/
+		void ingest() {
+			std::vector<uint64_t> accesses;
+			forEachAccess(lines, [&accesses](const PackedAddress& access) {
+				accesses.push_back((uint64_t{ access.port() } << 32) | access.address());
+			});
+			std::sort(accesses.begin(), accesses.end());
+
+			for (size_t i{ 0U }; i < accesses.size();) {
+				size_t end{ i + 1U };
+				while (end < accesses.size() && accesses[end] == accesses[i]) {
+					++end;
+				}
+				subnets.add(PackedAddress{ static_cast<uint32_t>(accesses[i]), static_cast<uint16_t>(accesses[i] >> 32) }, end - i);
+				i = end;
+			}
+		}
+	};
+
+	/**
+	* Splits a text into chunks of about the same size, cutting right after line breaks.
+	* Time: O(c + l), l being the longest line
+	* Space: O(c)
+	*
+	* @param text Text to split
+	* @param count Number of chunks
+	* @return Chunk texts, some of them may be empty
+	*/
+	std::vector<std::string_view> splitLines(std::string_view text, size_t count) {
+		std::vector<std::string_view> chunks;
+		chunks.reserve(count);
+		size_t begin{ 0U };
+		for (size_t i{ 1U }; i <= count; ++i) {
+			size_t end{ text.size() };
+			if (i < count) {
+				end = std::max(begin, text.size() / count * i);
+				const void* lineBreak{ std::memchr(text.data() + end, '\n', text.size() - end) };
+				end = (lineBreak == nullptr ? text.size() : static_cast<const char*>(lineBreak) - text.data() + 1U);
+			}
+			chunks.push_back(text.substr(begin, end - begin));
+			begin = end;
+		}
+		return chunks;
+	}
+
+	/**
+	* Splits a log into one chunk per thread and ingests each chunk on its own thread,
+	* the first one on the calling thread.
+	* Time: O(n / t)
+	* Space: O(m)
+	*
+	* @param text Contents of the log
+	* @param numThreads Number of threads, 0 for one per hardware thread
+	* @param args Extra arguments of the constructor of each chunk
+	* @return Ingested chunks, in the order of the log
+	*/
+	template <class Chunk, class... Args>
+	std::vector<Chunk> ingestChunks(std::string_view text, unsigned numThreads, const Args&... args) {
+		if (numThreads == 0U) {
+			numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+		}
+		const size_t numChunks{ std::max(std::min(size_t{ numThreads }, text.size() / MIN_CHUNK_SIZE), size_t{ 1U }) };
+
+		std::vector<Chunk> chunks;
+		chunks.reserve(numChunks);
+		for (std::string_view chunkText : splitLines(text, numChunks)) {
+			chunks.emplace_back(chunkText, numChunks, args...);
+		}
+
+		std::vector<std::thread> workers;
+		for (size_t c{ 1U }; c < chunks.size(); ++c) {
+			workers.emplace_back([&chunk = chunks[c]]() { chunk.ingest(); });
+		}
+		chunks[0].ingest();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		return chunks;
+	}
+
+	/**
+	* Reports the malformed lines of the chunks in the order of the log.
+	* Time: O(c)
+	* Space: O(1)
+	*
+	* @param chunks Ingested chunks
+	* @return Line counts of the whole log
+	*/
+	template <class Chunk>
+	IngestStats reportMalformed(const std::vector<Chunk>& chunks) {
+		IngestStats stats{ 0U, 0U };
+		for (const Chunk& chunk : chunks) {
+			const ChunkLines& lines{ chunk.lines };
+			for (size_t i{ 0U }; i < lines.malformed.size() && stats.malformedLines + i < MAX_REPORTED_MALFORMED_LINES; ++i) {
+				std::cerr << "[WARNING] Skipping malformed line " << stats.lines + lines.malformed[i].lineNumber << ": '" << lines.malformed[i].line << "'" << std::endl;
+			}
+			stats.lines += lines.lines;
+			stats.malformedLines += lines.malformedLines;
+		}
+		if (stats.malformedLines > MAX_REPORTED_MALFORMED_LINES) {
+			std::cerr << "[WARNING] Skipped " << stats.malformedLines << " malformed lines in total" << std::endl;
+		}
+		return stats;
+	}
+
+	/**
+	* Merges the ip counts of the ports of one shard into the ip maps of the merged port map.
+	* The ip maps moved into the merged map are empty in the chunks.
+	* Every shard touches different ip maps and only reads the chunks, so shards can be merged concurrently.
+	* Time: O(m / t)
+	* Space: O(1)
+	*
+	* @param targets Ip map of each port in the merged map, looked up before the merge so no thread searches the port maps
+	* @param firstChunk First chunk to merge, the ones before it are the start of the map
+	*/
+	void mergeShard(const std::vector<IpMap*>& targets, const std::vector<PortChunk>& chunks, size_t firstChunk, size_t shard) {
+		for (size_t c{ firstChunk }; c < chunks.size(); ++c) {
+			const PortMap& chunkMap{ chunks[c].portMap };
+			for (const PackedAddress& access : chunks[c].accesses[shard]) {
+				auto entry{ getIpAndPortFromAccess(access) };
+
+				// The ip map is empty if it was moved as a whole
+				const auto* count{ chunkMap.find(entry.first)->second.find(entry.second) };
+				if (count == nullptr) {
+					continue;
+				}
+
+				// Add the count of the chunk to the merged one, appending the ip if it is new
+				const unsigned chunkCount{ count->second };
+				targets[entry.first.port()]->upsert(entry.second, chunkCount, [chunkCount](unsigned& merged) { merged += chunkCount; });
+			}
+		}
+	}
+}
+
+IngestStats ingestLog(std::string_view text, PortMap& portMap, unsigned numThreads) {
+	std::vector<PortChunk> chunks{ ingestChunks<PortChunk>(text, numThreads) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	// The first chunk comes first in the log, its map is the start of the merged one unless the map already has counts
+	size_t firstChunk{ 0U };
+	if (portMap.empty()) {
+		portMap = std::move(chunks[0].portMap);
+		firstChunk = 1U;
+	}
+
+	// Add the ports in the order they first appear, moving the ip maps of new ones, and keep the ip map each merges into
+	std::vector<IpMap*> targets(size_t{ UINT16_MAX } + 1U, nullptr);
+	for (size_t c{ firstChunk }; c < chunks.size(); ++c) {
+		for (const Port& port : chunks[c].ports) {
+			auto& ipMap{ chunks[c].portMap.find(port)->second };
+			auto res{ portMap.try_emplace(port, std::move(ipMap)) };
+			if (!res.first) {
+				res.second->second.addNumConnections(ipMap.getNumConnections());
+			}
+			targets[port.port()] = &res.second->second;
+		}
+	}
+
+	// Merge the ips of the ports that were in several chunks, one shard of ports per thread
+	{
+		std::vector<std::thread> mergers;
+		for (size_t shard{ 1U }; shard < chunks.size(); ++shard) {
+			mergers.emplace_back(mergeShard, std::cref(targets), std::cref(chunks), firstChunk, shard);
+		}
+		mergeShard(targets, chunks, firstChunk, 0U);
+		for (auto& merger : mergers) {
+			merger.join();
+		}
+	}
+
+	return stats;
+}
+
+IngestStats ingestLog(std::string_view text, PortMap& portMap, DirtyPorts& dirtyPorts) {
+	std::vector<AppendChunk> chunks;
+	chunks.emplace_back(text, portMap, dirtyPorts);
+	chunks[0].ingest();
+	return reportMalformed(chunks);
+}
+
+IngestStats ingestLog(std::string_view text, FlatNetMap& netMap, unsigned numThreads) {
+	std::vector<FlatChunk> chunks{ ingestChunks<FlatChunk>(text, numThreads) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	// Add the chunks in the order of the log, so the pairs keep the order they first appear in
+	netMap = std::move(chunks[0].netMap);
+	for (size_t c{ 1U }; c < chunks.size(); ++c) {
+		netMap.merge(chunks[c].netMap);
+	}
+
+	return stats;
+}
+
+IngestStats ingestLog(std::string_view text, HeavyHitters& summary, unsigned numThreads) {
+	// Every chunk starts from a copy of the empty summary, so they all monitor as many keys
+	std::vector<HeavyChunk> chunks{ ingestChunks<HeavyChunk>(text, numThreads, summary) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	summary = std::move(chunks[0].summary);
+	for (size_t c{ 1U }; c < chunks.size(); ++c) {
+		summary.merge(chunks[c].summary);
+	}
+
+	return stats;
+}
+
+IngestStats ingestLog(std::string_view text, TimeWindows& windows, unsigned numThreads) {
+	// Every chunk starts empty with the same slots, the windows may already have counts
+	std::vector<WindowChunk> chunks{ ingestChunks<WindowChunk>(text, numThreads, windows) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	for (const WindowChunk& chunk : chunks) {
+		windows.merge(chunk.windows);
+	}
+
+	return stats;
+}
+
+IngestStats ingestLog(std::string_view text, ReasonStats& reasons, unsigned numThreads) {
+	std::vector<ReasonChunk> chunks{ ingestChunks<ReasonChunk>(text, numThreads) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	// Merged in the order of the log, so the IDs are given in the order the strings first appear
+	for (const ReasonChunk& chunk : chunks) {
+		reasons.merge(chunk.reasons);
+	}
+
+	return stats;
+}
+
+IngestStats ingestLog(std::string_view text, SubnetMap& subnets, unsigned numThreads) {
+	// Every chunk matches the ips to the same blocklist, the map may already have counts
+	std::vector<SubnetChunk> chunks{ ingestChunks<SubnetChunk>(text, numThreads, subnets) };
+	const IngestStats stats{ reportMalformed(chunks) };
+
+	size_t firstChunk{ 0U };
+	if (subnets.accesses() == 0U) {
+		subnets = std::move(chunks[0].subnets);
+		firstChunk = 1U;
+	}
+	for (size_t c{ firstChunk }; c < chunks.size(); ++c) {
+		subnets.merge(chunks[c].subnets);
+	}
+
+	return stats;
+}
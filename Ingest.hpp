@@ -0,0 +1,126 @@
+#ifndef INGEST_HPP
+#define INGEST_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <string_view>
+
+#include "NetMap.hpp"
+#include "TimeWindows.hpp"
+#include "ReasonStats.hpp"
+#include "Subnets.hpp"
+
+
+/**
+ * Line counts of an ingested log.
+ */
+struct IngestStats {
+	size_t lines; // Number of lines in the log
+	size_t malformedLines; // Number of lines skipped because they did not parse
+};
+
+/**
+* Builds the port map of a log.
+* The log is split at line boundaries into one chunk per thread, and each
+* thread builds its own port map. The maps are then merged in chunk order,
+* moving whole ip maps when a port is new, so the result is the same map,
+* with the same iteration order, as ingesting the log on a single thread.
+* If the map already has counts, such as the ones of a loaded snapshot,
+* the log is added on top of them as if it continued the one they came from.
+* Malformed lines are skipped and the first ones are reported on std::cerr.
+* Time: O(n / t + m), m being the entries of the chunk maps
+* Space: O(m)
+*
+* @param text Contents of the log
+* @param [out] portMap Map to add the counts to
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, PortMap& portMap, unsigned numThreads = 0U);
+
+/**
+* Adds the lines appended to a followed log to its port map on the calling
+* thread, which is faster than splitting the few new lines between threads.
+* Malformed lines are skipped and the first ones are reported on std::cerr,
+* numbered from the start of the new lines.
+* Time: O(n)
+* Space: O(m), m being the new entries
+*
+* @param text New lines of the log
+* @param [out] portMap Map to add the counts to
+* @param [out] dirtyPorts Set to add the ports whose counts changed to
+* @return Line counts of the new lines
+*/
+IngestStats ingestLog(std::string_view text, PortMap& portMap, DirtyPorts& dirtyPorts);
+
+/**
+* Counts the port and ip pairs of a log in a FlatNetMap, one table per thread
+* merged in chunk order. The PortMap view built from the result is the same
+* one ingestLog gives for a PortMap.
+* Time: O(n / t + m)
+* Space: O(m)
+*
+* @param text Contents of the log
+* @param [out] netMap Map to fill, must be empty
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, FlatNetMap& netMap, unsigned numThreads = 0U);
+
+/**
+* Summarizes the most accessed ports of a log and their most frequent ips in
+* bounded memory, one summary per thread merged in chunk order.
+* Time: O(n / t * (log p + log i) + t * p * i log i)
+* Space: O(t * p * i)
+*
+* @param text Contents of the log
+* @param [out] summary Summary to fill, must be empty. It sets the capacities of the per thread summaries
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, HeavyHitters& summary, unsigned numThreads = 0U);
+
+/**
+* Counts the accesses of a log in time windows by their timestamps, one set
+* of windows per thread merged into the given one. Lines without a valid
+* timestamp are skipped as malformed.
+* Time: O(n / t + t * (c + m)), c being the slots and m the entries of a set of windows
+* Space: O(t * (c + m))
+*
+* @param text Contents of the log, or lines appended to it
+* @param [out] windows Windows to add the counts to, they set the slots of the per thread ones
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, TimeWindows& windows, unsigned numThreads = 0U);
+
+/**
+* Counts the accesses of a log by the reason of the failure and the user
+* name of their messages, one set of counts per thread merged in chunk order.
+* Time: O(n / t + t * m), m being the entries of a set of counts
+* Space: O(t * m)
+*
+* @param text Contents of the log
+* @param [out] reasons Counts to add to
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, ReasonStats& reasons, unsigned numThreads = 0U);
+
+/**
+* Counts the ips of each port of a log in prefix tries, matching them to the
+* blocklist of the map if it has one, one map per thread merged in chunk order.
+* Time: O(n / t * (log n + l) + t * m * l), l being the depth of the tries and m the nodes of a map
+* Space: O(n + t * m)
+*
+* @param text Contents of the log
+* @param [out] subnets Map to add the counts to, its blocklist is used by the per thread ones
+* @param numThreads Number of threads to use, 0 for one per hardware thread
+* @return Line counts of the log
+*/
+IngestStats ingestLog(std::string_view text, SubnetMap& subnets, unsigned numThreads = 0U);
+
+#endif // !INGEST_HPP
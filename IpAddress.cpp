@@ -1,6 +1,8 @@
 #include "IpAddress.hpp"
 
-#include <sstream>
+#include <stdexcept>
+
+#include "LogParser.hpp"
 
 IpAddress::IpAddress() :
 	m_part1{ 0U },
@@ -18,21 +20,16 @@ IpAddress::IpAddress(unsigned part1, unsigned part2, unsigned part3, unsigned pa
 
 
 IpAddress::IpAddress(const std::string& ipStr) {
-	std::string buff;
-	for (const auto& ch : ipStr) {
-		buff.push_back(std::isdigit(ch) ? ch : ' ');
+	PackedAddress address;
+	if (!parseAddress(ipStr, address)) {
+		throw std::invalid_argument{ "Malformed ip address '" + ipStr + "'" };
 	}
 
-	std::istringstream iss{ buff };
-
-	unsigned part1, part2, part3, part4, port;
-	iss >> part1 >> part2 >> part3 >> part4 >> port;
-
-	m_part1 = part1;
-	m_part2 = part2;
-	m_part3 = part3;
-	m_part4 = part4;
-	m_port = port;
+	m_part1 = address.octet(0U);
+	m_part2 = address.octet(1U);
+	m_part3 = address.octet(2U);
+	m_part4 = address.octet(3U);
+	m_port = address.port();
 }
 
 
@@ -0,0 +1,47 @@
+#include "LogFollower.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Snapshot.hpp"
+
+LogFollower::LogFollower(const std::string& filename, uint64_t offset, uint64_t prefixHash) : m_filename{ filename }, m_offset{ offset }, m_prefixHash{ prefixHash }, m_lines{}, m_linesSize{ 0U } {}
+
+std::string_view LogFollower::poll(bool& rotated) {
+	rotated = false;
+
+	// Drop the lines returned by the last poll, keeping the partial one after them
+	m_lines.erase(0U, m_linesSize);
+	m_linesSize = 0U;
+
+	std::ifstream log{ m_filename, std::ios::binary };
+	if (!log.is_open()) {
+		return {};
+	}
+	log.seekg(0, std::ios::end);
+	const uint64_t size{ static_cast<uint64_t>(log.tellg()) };
+
+	// Recognize the log by its first bytes
+	std::string prefix(static_cast<size_t>(std::min(size, LOG_PREFIX_SIZE)), '\0');
+	log.seekg(0);
+	log.read(&prefix[0], static_cast<std::streamsize>(prefix.size()));
+	if (size < m_offset || hashLogPrefix(prefix, m_offset) != m_prefixHash) {
+		rotated = true;
+		m_offset = 0U;
+		m_lines.clear();
+	}
+
+	// Read the new bytes after the partial line
+	const size_t kept{ m_lines.size() };
+	m_lines.resize(kept + static_cast<size_t>(size - m_offset));
+	log.seekg(static_cast<std::streamoff>(m_offset));
+	log.read(&m_lines[kept], static_cast<std::streamsize>(size - m_offset));
+	m_lines.resize(kept + static_cast<size_t>(log.gcount()));
+	m_offset += static_cast<uint64_t>(log.gcount());
+	m_prefixHash = hashLogPrefix(prefix, m_offset);
+
+	// Return up to the last line break
+	const size_t lastBreak{ m_lines.rfind('\n') };
+	m_linesSize = (lastBreak == std::string::npos ? 0U : lastBreak + 1U);
+	return std::string_view{ m_lines }.substr(0U, m_linesSize);
+}
@@ -0,0 +1,56 @@
+#ifndef LOG_FOLLOWER_HPP
+#define LOG_FOLLOWER_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+/**
+ * Reader of the lines appended to a growing log, polled for them.
+ *
+ * Each poll reads the bytes written since the last one and returns the
+ * complete lines, keeping a partial last line for the next poll. The log
+ * is recognized by a hash of its first bytes, as with the snapshots. If it
+ * got shorter or starts differently, it was rotated or replaced, and the
+ * new file is read from its start.
+ */
+class LogFollower {
+	std::string m_filename; // Name of the log
+	uint64_t m_offset; // Number of bytes of the log read
+	uint64_t m_prefixHash; // Hash of the first bytes of the log read
+	std::string m_lines; // Complete lines of the last poll, followed by the partial line after them
+	size_t m_linesSize; // Number of bytes of the complete lines
+
+public:
+	/**
+	* Constructor of the follower.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param filename Name of the log
+	* @param offset Number of bytes of the log already read, ending with a line break
+	* @param prefixHash Hash of those bytes, as given by hashLogPrefix
+	*/
+	LogFollower(const std::string& filename, uint64_t offset, uint64_t prefixHash);
+
+	/**
+	* Reads the complete lines appended to the log since the last poll.
+	* A missing log is taken as one being rotated, with no new lines yet.
+	* Time: O(n), n being the new bytes
+	* Space: O(n)
+	*
+	* @param [out] rotated Wether the log was rotated or replaced, and the lines are the start of the new one
+	* @return New lines, valid until the next poll
+	*/
+	std::string_view poll(bool& rotated);
+
+	uint64_t offset() const { return m_offset; }
+};
+
+#endif // !LOG_FOLLOWER_HPP
@@ -0,0 +1,266 @@
+#include "LogParser.hpp"
+
+namespace {
+	// Abbreviated month names, in the order of the year
+	const char MONTH_NAMES[]{ "JanFebMarAprMayJunJulAugSepOctNovDec" };
+
+	// Days of the year before the first of each month, in a non leap year
+	const uint32_t DAYS_BEFORE_MONTH[12]{ 0U, 31U, 59U, 90U, 120U, 151U, 181U, 212U, 243U, 273U, 304U, 334U };
+
+	// Days of each month, in a non leap year
+	const unsigned DAYS_IN_MONTH[12]{ 31U, 28U, 31U, 30U, 31U, 30U, 31U, 31U, 30U, 31U, 30U, 31U };
+
+	bool isSpace(char ch) {
+		return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f';
+	}
+
+	/**
+	* Parses a decimal number from the current position, moving past it.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param [out] it Current position
+	* @param end End of the text
+	* @param maxDigits Maximum number of digits
+	* @param maxValue Maximum value
+	* @param [out] value Parsed number
+	* @return Wether there was a number in range
+	*/
+	bool parseNumber(const char*& it, const char* end, unsigned maxDigits, unsigned maxValue, unsigned& value) {
+		const char* start{ it };
+		unsigned number{ 0U };
+		for (; it != end && it - start < static_cast<ptrdiff_t>(maxDigits); ++it) {
+			const unsigned digit{ static_cast<unsigned>(*it - '0') };
+			if (digit > 9U) {
+				break;
+			}
+			number = number * 10U + digit;
+		}
+
+		if (it == start || number > maxValue) {
+			return false;
+		}
+		value = number;
+		return true;
+	}
+
+	/**
+	* Moves past the whitespace and then past the next field.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param [out] it Current position, at the end of the field on return
+	* @param end End of the text
+	* @return View of the field, empty if there was none
+	*/
+	std::string_view nextField(const char*& it, const char* end) {
+		while (it != end && isSpace(*it)) {
+			++it;
+		}
+		const char* start{ it };
+		while (it != end && !isSpace(*it)) {
+			++it;
+		}
+		return { start, static_cast<size_t>(it - start) };
+	}
+}
+
+bool parseAddress(std::string_view text, PackedAddress& address) {
+	const char* it{ text.data() };
+	const char* end{ text.data() + text.size() };
+
+	// Four octets separated by dots, then a colon and the port
+	unsigned parts[5];
+	for (unsigned i{ 0U }; i < 5U; ++i) {
+		if (!parseNumber(it, end, (i < 4U ? 3U : 5U), (i < 4U ? 255U : 65535U), parts[i])) {
+			return false;
+		}
+
+		const char separator{ (i < 3U ? '.' : ':') };
+		if (i < 4U) {
+			if (it == end || *it != separator) {
+				return false;
+			}
+			++it;
+		}
+	}
+
+	if (it != end) {
+		return false;
+	}
+
+	address = PackedAddress{ parts[0], parts[1], parts[2], parts[3], parts[4] };
+	return true;
+}
+
+bool parsePrefix(std::string_view text, uint32_t& address, unsigned& length) {
+	const char* it{ text.data() };
+	const char* end{ text.data() + text.size() };
+
+	// Four octets separated by dots
+	uint32_t bits{ 0U };
+	for (unsigned i{ 0U }; i < 4U; ++i) {
+		unsigned octet;
+		if (!parseNumber(it, end, 3U, 255U, octet)) {
+			return false;
+		}
+		bits = (bits << 8) | octet;
+
+		if (i < 3U) {
+			if (it == end || *it != '.') {
+				return false;
+			}
+			++it;
+		}
+	}
+
+	// Then the length of the network, if there is one
+	unsigned bitCount{ 32U };
+	if (it != end) {
+		if (*it != '/' || !parseNumber(++it, end, 2U, 32U, bitCount) || it != end) {
+			return false;
+		}
+	}
+
+	address = bits;
+	length = bitCount;
+	return true;
+}
+
+bool parseIpRange(std::string_view text, uint32_t& first, uint32_t& last) {
+	uint32_t address;
+	unsigned length;
+
+	// A network covers every address with its leading bits
+	const size_t dash{ text.find('-') };
+	if (dash == std::string_view::npos) {
+		if (!parsePrefix(text, address, length)) {
+			return false;
+		}
+		const uint32_t hostBits{ (length == 0U ? UINT32_MAX : (uint32_t{ 1U } << (32U - length)) - 1U) };
+		first = address & ~hostBits;
+		last = address | hostBits;
+		return true;
+	}
+
+	// Else two single addresses
+	uint32_t lastAddress;
+	if (!parsePrefix(text.substr(0U, dash), address, length) || length != 32U
+		|| !parsePrefix(text.substr(dash + 1U), lastAddress, length) || length != 32U || address > lastAddress) {
+		return false;
+	}
+	first = address;
+	last = lastAddress;
+	return true;
+}
+
+bool parsePortRange(std::string_view text, uint16_t& first, uint16_t& last) {
+	const char* it{ text.data() };
+	const char* end{ text.data() + text.size() };
+
+	unsigned firstPort;
+	if (!parseNumber(it, end, 5U, 65535U, firstPort)) {
+		return false;
+	}
+	unsigned lastPort{ firstPort };
+	if (it != end && (*it != '-' || !parseNumber(++it, end, 5U, 65535U, lastPort))) {
+		return false;
+	}
+	if (it != end || firstPort > lastPort) {
+		return false;
+	}
+
+	first = static_cast<uint16_t>(firstPort);
+	last = static_cast<uint16_t>(lastPort);
+	return true;
+}
+
+bool parseTimestamp(std::string_view text, uint32_t& seconds) {
+	const char* it{ text.data() };
+	const char* end{ text.data() + text.size() };
+
+	// Month name, then the day of the month
+	const std::string_view month{ nextField(it, end) };
+	if (month.size() != 3U) {
+		return false;
+	}
+	size_t m{ 0U };
+	while (m < 12U && std::string_view{ MONTH_NAMES + 3U * m, 3U } != month) {
+		++m;
+	}
+	const std::string_view dayField{ nextField(it, end) };
+	const char* dayIt{ dayField.data() };
+	unsigned day;
+	if (m == 12U || !parseNumber(dayIt, dayField.data() + dayField.size(), 2U, DAYS_IN_MONTH[m], day) || dayIt != dayField.data() + dayField.size() || day == 0U) {
+		return false;
+	}
+
+	// Hours, minutes and seconds separated by colons
+	const std::string_view time{ nextField(it, end) };
+	const char* timeIt{ time.data() };
+	const char* timeEnd{ time.data() + time.size() };
+	unsigned parts[3];
+	for (unsigned i{ 0U }; i < 3U; ++i) {
+		if (!parseNumber(timeIt, timeEnd, 2U, (i == 0U ? 23U : 59U), parts[i])) {
+			return false;
+		}
+		if (i < 2U) {
+			if (timeIt == timeEnd || *timeIt != ':') {
+				return false;
+			}
+			++timeIt;
+		}
+	}
+	if (timeIt != timeEnd || nextField(it, end).size() != 0U) {
+		return false;
+	}
+
+	seconds = ((DAYS_BEFORE_MONTH[m] + day - 1U) * 24U + parts[0]) * 3600U + parts[1] * 60U + parts[2];
+	return true;
+}
+
+void parseMessage(std::string_view message, std::string_view& reason, std::string_view& user) {
+	reason = message;
+	user = {};
+
+	// The user name is the last word, after the word naming it
+	const size_t lastSpace{ message.find_last_of(' ') };
+	if (lastSpace == std::string_view::npos || lastSpace == 0U) {
+		return;
+	}
+	const size_t wordStart{ message.find_last_of(' ', lastSpace - 1U) + 1U };
+	const std::string_view word{ message.substr(wordStart, lastSpace - wordStart) };
+	if (word == "user" || word == "for") {
+		reason = message.substr(0U, lastSpace);
+		user = message.substr(lastSpace + 1U);
+	}
+}
+
+bool parseLogLine(std::string_view line, LogRecord& record) {
+	const char* it{ line.data() };
+	const char* end{ line.data() + line.size() };
+
+	// The timestamp takes the first three fields
+	const std::string_view month{ nextField(it, end) };
+	nextField(it, end);
+	const std::string_view time{ nextField(it, end) };
+	if (time.empty()) {
+		return false;
+	}
+	record.timestamp = { month.data(), static_cast<size_t>(time.data() + time.size() - month.data()) };
+
+	// Then comes the address of the connection
+	if (!parseAddress(nextField(it, end), record.access)) {
+		return false;
+	}
+
+	// The rest is the message, without the surrounding whitespace
+	while (it != end && isSpace(*it)) {
+		++it;
+	}
+	while (end != it && isSpace(*(end - 1))) {
+		--end;
+	}
+	record.message = { it, static_cast<size_t>(end - it) };
+	return true;
+}
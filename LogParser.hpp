@@ -0,0 +1,113 @@
+#ifndef LOG_PARSER_HPP
+#define LOG_PARSER_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <string_view>
+
+#include "PackedAddress.hpp"
+
+
+/**
+ * Fields of a log line such as
+ * "Sep 23 12:58:18 80.169.79.65:1150 Failed password for illegal user root".
+ * The views point into the parsed line.
+ */
+struct LogRecord {
+	std::string_view timestamp; // First three fields, "Sep 23 12:58:18"
+	PackedAddress access; // Fourth field, address and port of the connection
+	std::string_view message; // Rest of the line after the fourth field
+};
+
+/**
+* Parses a dotted quad with port, such as "80.169.79.65:1150".
+* Time: O(n)
+* Space: O(1)
+*
+* @param text Text of the address, with nothing else around it
+* @param [out] address Parsed address, only written on success
+* @return Wether the text was a valid address
+*/
+bool parseAddress(std::string_view text, PackedAddress& address);
+
+/**
+* Parses a network in CIDR notation, such as "80.169.0.0/16", or a single
+* address, such as "80.169.79.65", which is taken as a /32 network.
+* Time: O(n)
+* Space: O(1)
+*
+* @param text Text of the network, with nothing else around it
+* @param [out] address Address of the network, only written on success
+* @param [out] length Number of leading bits of the network, only written on success
+* @return Wether the text was a valid network
+*/
+bool parsePrefix(std::string_view text, uint32_t& address, unsigned& length);
+
+/**
+* Parses a range of ips, such as "10.0.0.0-10.255.255.255", or a network in
+* CIDR notation, such as "10.0.0.0/8", which is the range of its ips.
+* Time: O(n)
+* Space: O(1)
+*
+* @param text Text of the range, with nothing else around it
+* @param [out] first First address of the range, only written on success
+* @param [out] last Last address of the range, included, only written on success
+* @return Wether the text was a valid range, with its first address not after the last one
+*/
+bool parseIpRange(std::string_view text, uint32_t& first, uint32_t& last);
+
+/**
+* Parses a range of ports, such as "1000-2000", or a single port.
+* Time: O(n)
+* Space: O(1)
+*
+* @param text Text of the range, with nothing else around it
+* @param [out] first First port of the range, only written on success
+* @param [out] last Last port of the range, included, only written on success
+* @return Wether the text was a valid range, with its first port not after the last one
+*/
+bool parsePortRange(std::string_view text, uint16_t& first, uint16_t& last);
+
+/**
+* Parses a log timestamp, such as "Sep 23 12:58:18", into the seconds since
+* the start of its year. The log has no years, so every timestamp is taken
+* to be of the same non leap year.
+* Time: O(1)
+* Space: O(1)
+*
+* @param text Timestamp of a LogRecord
+* @param [out] seconds Seconds since January 1 00:00:00, only written on success
+* @return Wether the text was a valid timestamp
+*/
+bool parseTimestamp(std::string_view text, uint32_t& seconds);
+
+/**
+* Splits the message of a log line into the reason of the failure and the
+* user name, such as "Failed password for illegal user" and "root". The
+* last word is the user name when it comes after "user" or "for", else
+* the whole message is the reason and there is no user name.
+* Time: O(n)
+* Space: O(1)
+*
+* @param message Message of a LogRecord
+* @param [out] reason Reason of the failure, pointing into the message
+* @param [out] user User name, pointing into the message, empty if there is none
+*/
+void parseMessage(std::string_view message, std::string_view& reason, std::string_view& user);
+
+/**
+* Splits a log line into its fields and parses the address, without allocating.
+* Time: O(n)
+* Space: O(1)
+*
+* @param line Line of the log, without the line break
+* @param [out] record Fields of the line, only complete on success
+* @return Wether the line had the four fields and a valid address
+*/
+bool parseLogLine(std::string_view line, LogRecord& record);
+
+#endif // !LOG_PARSER_HPP
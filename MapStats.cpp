@@ -0,0 +1,117 @@
+#include "MapStats.hpp"
+
+#include <string>
+
+namespace {
+	/**
+	* Writes a histogram as a JSON array, leaving out the empty buckets at its end.
+	* Time: O(h)
+	* Space: O(1)
+	*/
+	void writeHistogram(std::ostream& out, const MapStatsHistogram& histogram) {
+		size_t size{ histogram.size() };
+		while (size != 0U && histogram[size - 1U] == 0U) {
+			--size;
+		}
+		out << '[';
+		for (size_t i{ 0U }; i < size; ++i) {
+			out << (i == 0U ? "" : ", ") << histogram[i];
+		}
+		out << ']';
+	}
+
+	void mergeHistogram(MapStatsHistogram& histogram, const MapStatsHistogram& other) {
+		for (size_t i{ 0U }; i < histogram.size(); ++i) {
+			histogram[i] += other[i];
+		}
+	}
+
+	/**
+	* Gets the average of a total, 0 if there are no samples.
+	*/
+	double average(uint64_t total, uint64_t count) {
+		return (count == 0U ? 0.0 : static_cast<double>(total) / count);
+	}
+}
+
+void MapStats::merge(const MapStats& other) {
+	for (size_t i{ 0U }; i < m_operations.size(); ++i) {
+		Counters& stats{ m_operations[i] };
+		const Counters& otherStats{ other.m_operations[i] };
+		add(stats.count, load(otherStats.count));
+		add(stats.probes, load(otherStats.probes));
+		add(stats.comparisons, load(otherStats.comparisons));
+		raise(stats.longestProbe, load(otherStats.longestProbe));
+		for (size_t j{ 0U }; j < stats.probeHistogram.size(); ++j) {
+			add(stats.probeHistogram[j], load(otherStats.probeHistogram[j]));
+		}
+	}
+}
+
+void MapStats::reset() {
+	for (Counters& stats : m_operations) {
+		stats.count.store(0U, std::memory_order_relaxed);
+		stats.probes.store(0U, std::memory_order_relaxed);
+		stats.comparisons.store(0U, std::memory_order_relaxed);
+		stats.longestProbe.store(0U, std::memory_order_relaxed);
+		for (Counter& bucket : stats.probeHistogram) {
+			bucket.store(0U, std::memory_order_relaxed);
+		}
+	}
+}
+
+MapStats::OperationStats MapStats::operation(MapOperation operation) const {
+	const Counters& counters{ m_operations[static_cast<size_t>(operation)] };
+	OperationStats stats{ load(counters.count), load(counters.probes), load(counters.comparisons), load(counters.longestProbe), {} };
+	for (size_t i{ 0U }; i < stats.probeHistogram.size(); ++i) {
+		stats.probeHistogram[i] = load(counters.probeHistogram[i]);
+	}
+	return stats;
+}
+
+void MapStats::writeJson(std::ostream& out, size_t indent) const {
+	const char* names[]{ "find", "insert", "erase" };
+	const std::string pad(indent, ' ');
+	out << "{\n";
+	for (size_t i{ 0U }; i < m_operations.size(); ++i) {
+		const OperationStats stats{ operation(static_cast<MapOperation>(i)) };
+		out << pad << '"' << names[i] << "\": {\n" <<
+			pad << "    \"count\": " << stats.count << ",\n" <<
+			pad << "    \"probesPerOperation\": " << average(stats.probes, stats.count) << ",\n" <<
+			pad << "    \"comparisonsPerOperation\": " << average(stats.comparisons, stats.count) << ",\n" <<
+			pad << "    \"longestProbe\": " << stats.longestProbe << ",\n" <<
+			pad << "    \"probeHistogram\": ";
+		writeHistogram(out, stats.probeHistogram);
+		out << '\n' << pad << '}' << (i + 1U != m_operations.size() ? ",\n" : "\n");
+	}
+	out << std::string(indent - 4U, ' ') << '}';
+}
+
+void TableStats::merge(const TableStats& other) {
+	maps += other.maps;
+	inlineMaps += other.inlineMaps;
+	buckets += other.buckets;
+	entries += other.entries;
+	inlineEntries += other.inlineEntries;
+	occupiedBuckets += other.occupiedBuckets;
+	deletedBuckets += other.deletedBuckets;
+	longest = std::max(longest, other.longest);
+	mergeHistogram(histogram, other.histogram);
+}
+
+void TableStats::writeJson(std::ostream& out, size_t indent) const {
+	const std::string pad(indent, ' ');
+	out << "{\n" <<
+		pad << "\"maps\": " << maps << ",\n" <<
+		pad << "\"inlineMaps\": " << inlineMaps << ",\n" <<
+		pad << "\"buckets\": " << buckets << ",\n" <<
+		pad << "\"entries\": " << entries << ",\n" <<
+		pad << "\"inlineEntries\": " << inlineEntries << ",\n" <<
+		pad << "\"loadFactor\": " << average(entries - inlineEntries, buckets) << ",\n" <<
+		pad << "\"occupiedBuckets\": " << occupiedBuckets << ",\n" <<
+		pad << "\"deletedBuckets\": " << deletedBuckets << ",\n" <<
+		pad << (chained ? "\"longestChain\": " : "\"longestDistance\": ") << longest << ",\n" <<
+		pad << (chained ? "\"chainLengthHistogram\": " : "\"distanceHistogram\": ");
+	writeHistogram(out, histogram);
+	out << '\n' << std::string(indent - 4U, ' ') << '}';
+}
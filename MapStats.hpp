@@ -0,0 +1,242 @@
+#ifndef MAP_STATS_HPP
+#define MAP_STATS_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+
+/**
+ * Operations recorded by the statistics policies of the maps.
+ */
+enum class MapOperation { Find, Insert, Erase };
+
+// Number of buckets of the histograms, the last one counts every longer length
+const size_t MAP_STATS_HISTOGRAM_SIZE{ 32U };
+
+using MapStatsHistogram = std::array<uint64_t, MAP_STATS_HISTOGRAM_SIZE>;
+
+/**
+ * Statistics policy of the maps that records nothing. It is empty, so the maps
+ * derive from it without growing, and every call compiles to nothing.
+ */
+struct NoStats {
+	static constexpr bool kEnabled{ false };
+
+	/**
+	 * Counter of the work of one lookup, ignored.
+	 */
+	struct Probe {
+		void step() {}
+		void compare() {}
+	};
+
+	void record(MapOperation, const Probe&) const {}
+	void merge(const NoStats&) {}
+	void reset() {}
+};
+
+/**
+ * Statistics policy of the maps that records, for each kind of operation,
+ * how many buckets or slots its lookup visited and how many keys it compared.
+ *
+ * Lookups of a const map record too, so the totals are relaxed atomic
+ * counters, and threads reading the same map do not race on them.
+ */
+class MapStats {
+public:
+	static constexpr bool kEnabled{ true };
+
+	/**
+	 * Counter of the work of one lookup. A step is one node of a chain, one slot
+	 * of a Robin Hood run or one group of control bytes, and a comparison is one
+	 * call to the key equality operator.
+	 */
+	struct Probe {
+		uint32_t length{ 0U }; // Number of steps
+		uint32_t comparisons{ 0U }; // Number of key comparisons
+
+		void step() { ++length; }
+		void compare() { ++comparisons; }
+	};
+
+	/**
+	 * Totals of one kind of operation, as read at one time.
+	 */
+	struct OperationStats {
+		uint64_t count; // Number of operations
+		uint64_t probes; // Sum of the probe lengths
+		uint64_t comparisons; // Sum of the key comparisons
+		uint64_t longestProbe; // Longest probe length
+		MapStatsHistogram probeHistogram; // Number of operations with each probe length
+	};
+
+private:
+	using Counter = std::atomic<uint64_t>;
+
+	/**
+	 * Counters of one kind of operation.
+	 */
+	struct Counters {
+		Counter count; // Number of operations
+		Counter probes; // Sum of the probe lengths
+		Counter comparisons; // Sum of the key comparisons
+		Counter longestProbe; // Longest probe length
+		std::array<Counter, MAP_STATS_HISTOGRAM_SIZE> probeHistogram; // Number of operations with each probe length
+	};
+
+	mutable std::array<Counters, 3U> m_operations; // Totals of each MapOperation, updated by const lookups
+
+	static void add(Counter& counter, uint64_t value) { counter.fetch_add(value, std::memory_order_relaxed); }
+
+	static uint64_t load(const Counter& counter) { return counter.load(std::memory_order_relaxed); }
+
+	/**
+	* Raises a counter to a value if it is lower.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	static void raise(Counter& counter, uint64_t value) {
+		uint64_t current{ load(counter) };
+		while (current < value && !counter.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+public:
+	MapStats() : m_operations{} { reset(); }
+
+	MapStats(const MapStats& copy) : MapStats{} { merge(copy); }
+
+	MapStats& operator=(const MapStats& other) {
+		if (this != &other) {
+			reset();
+			merge(other);
+		}
+		return *this;
+	}
+
+	/**
+	* Adds the probe of an operation to the totals. Safe to call from several threads at once.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param operation Kind of operation
+	* @param probe Work of its lookup
+	*/
+	void record(MapOperation operation, const Probe& probe) const {
+		Counters& stats{ m_operations[static_cast<size_t>(operation)] };
+		add(stats.count, 1U);
+		add(stats.probes, probe.length);
+		add(stats.comparisons, probe.comparisons);
+		raise(stats.longestProbe, probe.length);
+		add(stats.probeHistogram[std::min(size_t{ probe.length }, MAP_STATS_HISTOGRAM_SIZE - 1U)], 1U);
+	}
+
+	/**
+	* Adds the totals of another map, to report a set of maps as a whole.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	void merge(const MapStats& other);
+
+	/**
+	* Sets every total back to zero.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	void reset();
+
+	/**
+	* Reads the totals of one kind of operation.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	OperationStats operation(MapOperation operation) const;
+
+	/**
+	* Writes the totals as a JSON object.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param [out] out Stream to write to
+	* @param indent Number of spaces before the lines inside the object
+	*/
+	void writeJson(std::ostream& out, size_t indent) const;
+};
+
+/**
+ * Shape of the table of a map, or of a set of maps added together, taken by
+ * scanning it. For chaining maps the histogram counts the buckets with each
+ * chain length. For open addressing maps it counts the entries at each
+ * distance from their home slot.
+ */
+struct TableStats {
+	bool chained; // Wether the lengths are chain lengths instead of distances from the home slot
+	uint64_t maps; // Number of maps added together
+	uint64_t inlineMaps; // Number of maps still keeping their entries inline
+	uint64_t buckets; // Number of buckets or slots
+	uint64_t entries; // Number of entries
+	uint64_t inlineEntries; // Number of entries kept inline, which are not in any bucket
+	uint64_t occupiedBuckets; // Number of buckets or slots holding at least one entry
+	uint64_t deletedBuckets; // Number of slots holding an erased marker
+	uint64_t longest; // Longest chain, or farthest distance from the home slot
+	MapStatsHistogram histogram; // Number of buckets with each chain length, or of entries at each distance
+
+	explicit TableStats(bool t_chained) : chained{ t_chained }, maps{ 0U }, inlineMaps{ 0U }, buckets{ 0U }, entries{ 0U }, inlineEntries{ 0U }, occupiedBuckets{ 0U }, deletedBuckets{ 0U }, longest{ 0U }, histogram{} {}
+
+	/**
+	* Counts a chain length or a distance from the home slot.
+	*/
+	void addLength(uint64_t length) {
+		longest = std::max(longest, length);
+		histogram[std::min(static_cast<size_t>(length), MAP_STATS_HISTOGRAM_SIZE - 1U)]++;
+	}
+
+	/**
+	* Adds the shape of the table of another map.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	void merge(const TableStats& other);
+
+	/**
+	* Writes the shape as a JSON object.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param [out] out Stream to write to
+	* @param indent Number of spaces before the lines inside the object
+	*/
+	void writeJson(std::ostream& out, size_t indent) const;
+};
+
+/**
+* Writes the table shape and, if the policy records them, the operation totals of a map as a JSON object.
+* Time: O(1)
+* Space: O(1)
+*
+* @param [out] out Stream to write to
+* @param table Shape of the table
+* @param operations Statistics policy of the map
+* @param indent Number of spaces before the lines inside the object, at least 4
+*/
+template <class Stats>
+void writeStatsJson(std::ostream& out, const TableStats& table, const Stats& operations, size_t indent) {
+	const std::string pad(indent, ' ');
+	out << "{\n" << pad << "\"table\": ";
+	table.writeJson(out, indent + 4U);
+	if constexpr (Stats::kEnabled) {
+		out << ",\n" << pad << "\"operations\": ";
+		operations.writeJson(out, indent + 4U);
+	}
+	out << '\n' << std::string(indent - 4U, ' ') << '}';
+}
+
+#endif // !MAP_STATS_HPP
@@ -0,0 +1,502 @@
+#ifndef NET_MAP_HPP
+#define NET_MAP_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "PackedAddress.hpp"
+#include "HashMap.hpp"
+#include "HashMapInternalChaining.hpp"
+#include "SpaceSaving.hpp"
+#include "HyperLogLog.hpp"
+
+
+// Bucket counts of the form 2^n - 1, which are not primes. net_map.txt lists the ports in bucket order, so they stay as they are
+const std::vector<size_t> PRIMES{
+	 7U,
+	 63U,
+	 511U,
+	 1023U,
+	 2047U,
+	 4095U,
+	 8191U,
+	 16383U,
+	 32767U,
+	 65535U,
+	 131071U,
+	 262143U,
+	 524287U,
+	 1048575U,
+	 2097151U,
+	 4194303U,
+	 8388607U,
+	 16777215U
+};
+
+// Bucket count of the ip maps
+const size_t IP_MAP_SIZE{ PRIMES[1] };
+
+// Initial bucket count of the port map, it grows as ports are found
+const size_t PORT_MAP_SIZE{ PRIMES[0] };
+
+// Number of ips kept inline in an ip map before it builds its buckets, most ports are accessed by a few ips
+const size_t IP_MAP_INLINE_CAPACITY{ 4U };
+
+// Statistics policy of the port and ip maps, MapStats records the probes of every operation to size the tables
+using NetMapStats = NoStats;
+
+// Number of ports monitored by default by the heavy hitter summary
+const size_t HEAVY_HITTER_PORTS{ 1024U };
+
+// Number of ips monitored for each port of the heavy hitter summary
+const size_t HEAVY_HITTER_IPS{ 64U };
+
+// Register index bits of the distinct ip sketches of the ports, 1 KB and about 3% error each
+const unsigned DISTINCT_IPS_PRECISION{ 10U };
+
+/**
+* Extends the PackedAddress class to represent an input connection from an ipv4.
+* 
+* @return Ip
+*/
+class Ip : public PackedAddress {
+
+public:
+	using Hasher = PackedAddress::Hasher;
+	
+	Ip(uint32_t address) : PackedAddress{ address, 0U } {}
+
+	friend std::ostream& operator<<(std::ostream& out, const Ip& ip) {
+		out << ip.octet(0U) << '.' << ip.octet(1U) << '.' << ip.octet(2U) << '.' << ip.octet(3U);
+		return out;
+	}
+};
+
+/**
+* Extends the PackedAddress to represent an access port in the server.
+* 
+* @return Port
+*/
+class Port : public PackedAddress {
+
+public:
+	using Hasher = PackedAddress::Hasher;
+
+	Port(uint16_t port) : PackedAddress{ 0U, port } {}
+
+	friend std::ostream& operator<<(std::ostream& out, const Port& port) {
+		out << port.port();
+		return out;
+	}
+};
+
+/**
+* Splits the full ip addresss in to ipv4 and port.
+* Time: O(1)
+* Space: O(1)
+* 
+* @param connection PackedAddress of the the connection
+* @return pair of Port and Ip
+*/
+inline std::pair<Port, Ip> getIpAndPortFromAccess(const PackedAddress& connection){
+	return { Port{ connection.port() }, Ip{ connection.address() } };
+}
+
+
+/**
+* Helper class extending the hash map to add a counter and manage input connections.
+* 
+* @reutrn IpMap
+*/
+class IpMap : public HashMapInternalChaining<Ip, unsigned, Ip::Hasher, IP_MAP_INLINE_CAPACITY, NetMapStats>{
+	unsigned m_numConnections;
+	
+public:
+	IpMap() : HashMapInternalChaining<Ip, unsigned, Ip::Hasher, IP_MAP_INLINE_CAPACITY, NetMapStats>{ IP_MAP_SIZE }, m_numConnections{ 0U } {}
+
+	void incNumConnections() {
+		m_numConnections++;
+	}
+
+	void addNumConnections(unsigned numConnections) {
+		m_numConnections += numConnections;
+	}
+	
+	unsigned getNumConnections()const {
+		return m_numConnections;
+	}
+
+};
+
+// Map of each port to the ips that accessed it
+using PortMap = HashMapInternalChaining<Port, IpMap, Port::Hasher, 0U, NetMapStats>;
+
+/**
+* Flat alternative to the PortMap of IpMaps. Counts each distinct port and ip
+* pair in a single open addressing table keyed on the packed access, so
+* each record costs one hash and one probe. The per port totals are kept
+* in a side table indexed by port number. Each pair also keeps the order
+* it first appeared in, which is what the PortMap views need to be rebuilt
+* with the same iteration order as if they had been built directly.
+*
+* @return FlatNetMap
+*/
+class FlatNetMap {
+	/**
+	 * Counter of one port and ip pair.
+	 */
+	struct PairCount {
+		uint32_t order; // Number of distinct pairs seen before this one
+		unsigned count; // Number of accesses
+	};
+
+	using CountMap = HashMap<PackedAddress, PairCount, PackedAddress::Hasher>;
+
+	static constexpr size_t kPortCount{ 1U << 16 }; // Number of possible ports
+
+	CountMap m_counts; // Counter of each pair
+	std::vector<unsigned> m_portTotals; // Number of accesses of each port
+
+	/**
+	* Runs a callback on each pair in the order they first appeared.
+	* Time: O(m)
+	* Space: O(m)
+	*
+	* @param func Function taking the const PackedAddress& access and the unsigned count of each pair
+	*/
+	template <class PairFunction>
+	void forEachPair(PairFunction func) const {
+		std::vector<const CountMap::Entry*> ordered(m_counts.size());
+		m_counts.forEach([&ordered](const CountMap::Entry& entry) {
+			ordered[entry.second.order] = &entry;
+		});
+		for (const CountMap::Entry* entry : ordered) {
+			func(entry->first, entry->second.count);
+		}
+	}
+
+public:
+	FlatNetMap() : m_counts{}, m_portTotals(kPortCount, 0U) {}
+
+	/**
+	* Counts accesses of a port and ip pair.
+	* Time: O(1) amortized
+	* Space: O(1) amortized
+	*
+	* @param access Ip and port of the access
+	* @param count Number of accesses to add
+	*/
+	void add(const PackedAddress& access, unsigned count = 1U) {
+		auto res{ m_counts.try_emplace(access, PairCount{ static_cast<uint32_t>(m_counts.size()), 0U }) };
+		res.second->second.count += count;
+		m_portTotals[access.port()] += count;
+	}
+
+	/**
+	* Adds the counts of a map built from a later part of the log.
+	* Time: O(m), m being the pairs of the other map
+	* Space: O(m)
+	*
+	* @param other Map to add
+	*/
+	void merge(const FlatNetMap& other) {
+		other.forEachPair([this](const PackedAddress& access, unsigned count) {
+			add(access, count);
+		});
+	}
+
+	/**
+	* Gets the number of distinct port and ip pairs.
+	*/
+	size_t size() const { return m_counts.size(); }
+
+	/**
+	* Gets the number of accesses of a port.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	unsigned portTotal(const Port& port) const { return m_portTotals[port.port()]; }
+
+	/**
+	* Builds the PortMap view of the counts, the same one ingesting the log into a PortMap gives.
+	* Time: O(m)
+	* Space: O(m)
+	*
+	* @param [out] portMap Map to fill, must be empty
+	*/
+	void buildPortMap(PortMap& portMap) const {
+		forEachPair([this, &portMap](const PackedAddress& access, unsigned count) {
+			auto entry{ getIpAndPortFromAccess(access) };
+			auto res{ portMap.try_emplace(entry.first) };
+			if (res.first) {
+				res.second->second.addNumConnections(portTotal(entry.first));
+			}
+			res.second->second.try_emplace(entry.second, count);
+		});
+	}
+
+	/**
+	* Builds the IpMap view of a single port.
+	* Time: O(m)
+	* Space: O(m)
+	*
+	* @param port Port to build the view of
+	* @return Ips of the port with their number of accesses
+	*/
+	IpMap buildIpMap(const Port& port) const {
+		IpMap ipMap;
+		ipMap.addNumConnections(portTotal(port));
+		forEachPair([&port, &ipMap](const PackedAddress& access, unsigned count) {
+			if (access.port() == port.port()) {
+				ipMap.try_emplace(Ip{ access.address() }, count);
+			}
+		});
+		return ipMap;
+	}
+};
+
+/**
+* Set of the ports whose counts changed since it was last cleared, so a
+* report that only depends on the changed counts looks at those ports
+* instead of walking the whole port map.
+*
+* @return DirtyPorts
+*/
+class DirtyPorts {
+	static constexpr size_t kPortCount{ 1U << 16 }; // Number of possible ports
+
+	std::vector<bool> m_marked; // Wether each port is in the set
+	std::vector<Port> m_ports; // Ports in the set, in the order they were marked
+
+public:
+	DirtyPorts() : m_marked(kPortCount, false), m_ports{} {}
+
+	/**
+	* Adds a port to the set.
+	* Time: O(1)
+	* Space: O(1) amortized
+	*/
+	void mark(const Port& port) {
+		if (!m_marked[port.port()]) {
+			m_marked[port.port()] = true;
+			m_ports.push_back(port);
+		}
+	}
+
+	/**
+	* Empties the set.
+	* Time: O(d)
+	* Space: O(1)
+	*/
+	void clear() {
+		for (const Port& port : m_ports) {
+			m_marked[port.port()] = false;
+		}
+		m_ports.clear();
+	}
+
+	bool contains(const Port& port) const { return m_marked[port.port()]; }
+
+	const std::vector<Port>& ports() const { return m_ports; }
+
+	bool empty() const { return m_ports.empty(); }
+};
+
+/**
+* Estimates the number of distinct ips that accessed each port with one
+* HyperLogLog sketch per port, instead of keeping every ip in an IpMap.
+* The sketches take 2^p bytes each whatever the number of ips, so the
+* whole map is bounded by the 65536 ports. A precision of 0 disables it.
+*
+* @return PortCardinality
+*/
+class PortCardinality {
+	unsigned m_precision; // Register index bits of the sketches, 0 when disabled
+	HashMap<Port, HyperLogLog, Port::Hasher> m_sketches; // Sketch of the ips of each port
+
+public:
+	/**
+	* Constructor of the map.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param precision Register index bits of the sketches, 0 to disable them
+	*/
+	explicit PortCardinality(unsigned precision = DISTINCT_IPS_PRECISION) : m_precision{ precision }, m_sketches{} {}
+
+	/**
+	* Adds the ip of an access to the sketch of its port.
+	* Time: O(1)
+	* Space: O(2^p) the first time the port is seen
+	*
+	* @param access Ip and port of the access
+	*/
+	void add(const PackedAddress& access) {
+		if (m_precision == 0U) {
+			return;
+		}
+		// The sketch indexes its registers by the top bits of a 64 bit hash, which Ip::Hasher truncates to size_t on 32 bit builds
+		auto entry{ getIpAndPortFromAccess(access) };
+		m_sketches.try_emplace(entry.first, m_precision).second->second.add(PackedAddress::mix(entry.second.value()));
+	}
+
+	/**
+	* Adds the ips of another map with the same precision, from other threads or logs.
+	* Time: O(q * 2^p), q being the ports of the other map
+	* Space: O(q * 2^p)
+	*
+	* @param other Map to add
+	*/
+	void merge(const PortCardinality& other) {
+		other.m_sketches.forEach([this](const std::pair<const Port, HyperLogLog>& entry) {
+			m_sketches.try_emplace(entry.first, m_precision).second->second.merge(entry.second);
+		});
+	}
+
+	/**
+	* Estimates the number of distinct ips that accessed a port.
+	* Time: O(2^p)
+	* Space: O(1)
+	*
+	* @param port Port to estimate
+	* @return Estimated number of ips, 0 if the port was not seen
+	*/
+	uint64_t estimate(const Port& port) const {
+		const auto* sketch{ m_sketches.find(port) };
+		return (sketch == nullptr ? 0U : static_cast<uint64_t>(std::llround(sketch->second.estimate())));
+	}
+
+	bool enabled() const { return m_precision != 0U; }
+
+	unsigned precision() const { return m_precision; }
+
+	/**
+	* Gets the number of ports with a sketch.
+	*/
+	size_t size() const { return m_sketches.size(); }
+};
+
+/**
+* Bounded memory summary of the most accessed ports and of the ips that
+* access them most, for logs too large to keep a PortMap of. The ports
+* are counted with a Space-Saving summary, and each monitored port keeps
+* a Space-Saving summary of its ips. The ip summary of a port starts when
+* the port is monitored and is dropped when it stops being monitored, so
+* the accesses of the port it missed are at most the error of the port.
+*
+* For a monitored port, count - error <= true accesses <= count.
+* For an ip of a monitored port, count - error <= true accesses <= count + portError.
+*
+* Optionally, the distinct ips of every port, monitored or not, are
+* estimated with a PortCardinality.
+*
+* @return HeavyHitters
+*/
+class HeavyHitters {
+public:
+	using PortSummary = SpaceSaving<Port, Port::Hasher>;
+	using IpSummary = SpaceSaving<Ip, Ip::Hasher>;
+
+private:
+	size_t m_ipCapacity; // Number of ips monitored for each port
+	PortSummary m_ports; // Counters of the monitored ports
+	HashMap<Port, IpSummary, Port::Hasher> m_ips; // Counters of the ips of each monitored port
+	PortCardinality m_distinctIps; // Distinct ip sketches of every port
+
+public:
+	/**
+	* Constructor of the summary.
+	* Time: O(1)
+	* Space: O(1), O(p * i) once full
+	*
+	* @param portCapacity Number of monitored ports
+	* @param ipCapacity Number of ips monitored for each port
+	* @param distinctIpsPrecision Register index bits of the distinct ip sketches, 0 to not estimate distinct ips
+	*/
+	HeavyHitters(size_t portCapacity = HEAVY_HITTER_PORTS, size_t ipCapacity = HEAVY_HITTER_IPS, unsigned distinctIpsPrecision = 0U) :
+		m_ipCapacity{ ipCapacity }, m_ports{ portCapacity }, m_ips{}, m_distinctIps{ distinctIpsPrecision } {}
+
+	/**
+	* Counts an access.
+	* Time: O(log p + log i)
+	* Space: O(1)
+	*
+	* @param access Ip and port of the access
+	*/
+	void add(const PackedAddress& access) {
+		auto entry{ getIpAndPortFromAccess(access) };
+		m_ports.add(entry.first, 1U, [this](const Port& evicted) { m_ips.erase(evicted); });
+		m_ips.try_emplace(entry.first, m_ipCapacity).second->second.add(entry.second);
+		m_distinctIps.add(access);
+	}
+
+	/**
+	* Adds the counts of a summary of another part of the log.
+	* Time: O(p * i log i)
+	* Space: O(p * i)
+	*
+	* @param other Summary to add
+	*/
+	void merge(const HeavyHitters& other) {
+		m_ports.merge(other.m_ports);
+
+		// Keep the ips of the ports that are still monitored, adding the ones of the other summary
+		HashMap<Port, IpSummary, Port::Hasher> ips;
+		m_ports.forEach([this, &other, &ips](const PortSummary::Counter& counter) {
+			auto* own{ m_ips.find(counter.key) };
+			IpSummary& merged{ ips.try_emplace(counter.key, m_ipCapacity).second->second };
+			if (own != nullptr) {
+				merged = std::move(own->second);
+			}
+			const auto* others{ other.m_ips.find(counter.key) };
+			if (others != nullptr) {
+				merged.merge(others->second);
+			}
+		});
+		m_ips = std::move(ips);
+		m_distinctIps.merge(other.m_distinctIps);
+	}
+
+	/**
+	* Gets the most accessed ports.
+	* Time: O(p log p)
+	* Space: O(p)
+	*
+	* @param n Maximum number of ports
+	* @return Port counters, most accessed first
+	*/
+	std::vector<PortSummary::Counter> topPorts(size_t n) const { return m_ports.top(n); }
+
+	/**
+	* Gets the ips that accessed a monitored port the most.
+	* Time: O(i log i)
+	* Space: O(i)
+	*
+	* @param port Monitored port
+	* @param n Maximum number of ips
+	* @return Ip counters, most frequent first, empty if the port is not monitored
+	*/
+	std::vector<IpSummary::Counter> topIps(const Port& port, size_t n) const {
+		const auto* ips{ m_ips.find(port) };
+		return (ips == nullptr ? std::vector<IpSummary::Counter>{} : ips->second.top(n));
+	}
+
+	/**
+	* Gets the distinct ip estimates of the ports, disabled if the summary was built without them.
+	*/
+	const PortCardinality& distinctIps() const { return m_distinctIps; }
+
+	/**
+	* Gets the number of accesses counted.
+	*/
+	uint64_t total() const { return m_ports.total(); }
+};
+
+#endif // !NET_MAP_HPP
@@ -0,0 +1,135 @@
+#ifndef NODE_POOL_HPP
+#define NODE_POOL_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Slab allocator for fixed size nodes.
+ * Hands out uninitialized storage for one T at a time, carved from
+ * contiguous blocks that double in size up to a limit. Deallocated
+ * storage goes onto a free list and is reused first. Blocks are only
+ * freed all together, on release() or destruction, so the owner must
+ * destroy the objects it constructed before that.
+ *
+ * @param T Type of the node
+ */
+template <class T>
+class NodePool {
+	union Cell {
+		Cell* next; // Next free cell, while the cell is on the free list
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage; // Node storage, while allocated
+	};
+
+	static constexpr size_t kMinBlockSize{ 4U }; // Cells in the first block
+	static constexpr size_t kMaxBlockSize{ 4096U }; // Cells in the biggest blocks
+
+	std::vector<std::unique_ptr<Cell[]>> m_blocks; // Allocated blocks, the last one is being carved
+	Cell* m_free; // Head of the free list
+	size_t m_blockSize; // Number of cells of the last block
+	size_t m_blockUsed; // Number of cells carved from the last block
+	size_t m_capacity; // Number of cells in all the blocks
+
+public:
+	/**
+	 * Default constructor for NodePool. Does not allocate.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @return NodePool
+	 */
+	NodePool() : m_blocks{}, m_free{ nullptr }, m_blockSize{ 0U }, m_blockUsed{ 0U }, m_capacity{ 0U } {}
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	NodePool(NodePool&& other) noexcept : NodePool{} { swap(other); }
+
+	NodePool& operator=(NodePool&& other) noexcept {
+		NodePool moved{ std::move(other) };
+		swap(moved);
+		return *this;
+	}
+
+	/**
+	 * Gets storage for one node.
+	 * Time: O(1) amortized
+	 * Space: O(1) amortized
+	 *
+	 * @return Pointer to uninitialized storage for a T
+	 */
+	T* allocate() {
+		Cell* cell{ m_free };
+		if (cell != nullptr) {
+			// Reuse a deallocated cell
+			m_free = cell->next;
+		}
+		else {
+			// Carve the next cell of the last block, adding a bigger block when it is used up
+			if (m_blockUsed == m_blockSize) {
+				m_blockSize = (m_blockSize == 0U ? kMinBlockSize : std::min(m_blockSize * 2U, kMaxBlockSize));
+				m_blocks.emplace_back(new Cell[m_blockSize]);
+				m_blockUsed = 0U;
+				m_capacity += m_blockSize;
+			}
+			cell = &m_blocks.back()[m_blockUsed++];
+		}
+		return reinterpret_cast<T*>(&cell->storage);
+	}
+
+	/**
+	 * Gives back the storage of a node that was already destroyed.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param node Pointer returned by allocate()
+	 */
+	void deallocate(T* node) {
+		Cell* cell{ reinterpret_cast<Cell*>(node) };
+		cell->next = m_free;
+		m_free = cell;
+	}
+
+	/**
+	 * Frees every block at once.
+	 * Time: O(b), b being the number of blocks
+	 * Space: O(1)
+	 */
+	void release() {
+		m_blocks.clear();
+		m_blocks.shrink_to_fit();
+		m_free = nullptr;
+		m_blockSize = 0U;
+		m_blockUsed = 0U;
+		m_capacity = 0U;
+	}
+
+	/**
+	 * Gets the number of nodes the blocks can hold.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @return Pool capacity
+	 */
+	size_t capacity() const { return m_capacity; }
+
+	void swap(NodePool& other) noexcept {
+		using std::swap;
+		swap(m_blocks, other.m_blocks);
+		swap(m_free, other.m_free);
+		swap(m_blockSize, other.m_blockSize);
+		swap(m_blockUsed, other.m_blockUsed);
+		swap(m_capacity, other.m_capacity);
+	}
+};
+
+#endif // !NODE_POOL_HPP
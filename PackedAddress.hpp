@@ -0,0 +1,93 @@
+#ifndef PACKED_ADDRESS_HPP
+#define PACKED_ADDRESS_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <iostream>
+
+#include "IpAddress.hpp"
+
+
+/**
+ * IPv4 address and port packed in a single 64 bit word, with the address
+ * in bits 16 to 47 and the port in bits 0 to 15. Equality and ordering
+ * are single integer comparisons, and the order matches the one of
+ * IpAddress: by address octets first, then by port.
+ */
+class PackedAddress {
+protected:
+	uint64_t m_value; // Packed address and port
+
+public:
+	/**
+	 * Hashes the packed word with an integer mixing function, without building strings.
+	 */
+	struct Hasher {
+		size_t operator()(const PackedAddress& address) const {
+			return static_cast<size_t>(mix(address.m_value));
+		}
+	};
+
+	PackedAddress() : m_value{ 0U } {}
+
+	PackedAddress(uint32_t address, uint16_t port) : m_value{ (static_cast<uint64_t>(address) << 16) | port } {}
+
+	PackedAddress(unsigned part1, unsigned part2, unsigned part3, unsigned part4, unsigned port) :
+		PackedAddress{ (part1 << 24) | (part2 << 16) | (part3 << 8) | part4, static_cast<uint16_t>(port) } {}
+
+	explicit PackedAddress(const IpAddress& ip) : PackedAddress{ ip.m_part1, ip.m_part2, ip.m_part3, ip.m_part4, ip.m_port } {}
+
+	/**
+	 * Gets the 32 bit address, with the first octet in the highest byte.
+	 */
+	uint32_t address() const { return static_cast<uint32_t>(m_value >> 16); }
+
+	uint16_t port() const { return static_cast<uint16_t>(m_value); }
+
+	uint64_t value() const { return m_value; }
+
+	/**
+	 * Gets an octet of the address.
+	 *
+	 * @param i Index of the octet, 0 being the first one
+	 * @return Octet value
+	 */
+	unsigned octet(unsigned i) const { return static_cast<unsigned>(m_value >> (40U - 8U * i)) & 0xFFU; }
+
+	IpAddress toIpAddress() const { return IpAddress{ octet(0U), octet(1U), octet(2U), octet(3U), port() }; }
+
+	/**
+	 * Finalizer of MurmurHash3, spreads every input bit over the whole word.
+	 * Time: O(1)
+	 * Space: O(1)
+	 *
+	 * @param x Word to mix
+	 * @return Mixed word
+	 */
+	static uint64_t mix(uint64_t x) {
+		x ^= x >> 33;
+		x *= 0xFF51AFD7ED558CCDULL;
+		x ^= x >> 33;
+		x *= 0xC4CEB9FE1A85EC53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+
+	friend bool operator==(const PackedAddress& l, const PackedAddress& r) { return l.m_value == r.m_value; }
+	friend bool operator!=(const PackedAddress& l, const PackedAddress& r) { return l.m_value != r.m_value; }
+	friend bool operator<(const PackedAddress& l, const PackedAddress& r) { return l.m_value < r.m_value; }
+	friend bool operator>(const PackedAddress& l, const PackedAddress& r) { return l.m_value > r.m_value; }
+	friend bool operator<=(const PackedAddress& l, const PackedAddress& r) { return l.m_value <= r.m_value; }
+	friend bool operator>=(const PackedAddress& l, const PackedAddress& r) { return l.m_value >= r.m_value; }
+
+	friend std::ostream& operator<<(std::ostream& out, const PackedAddress& address) {
+		out << address.octet(0U) << '.' << address.octet(1U) << '.' << address.octet(2U) << '.' << address.octet(3U) << ':' << address.port();
+		return out;
+	}
+};
+
+#endif // !PACKED_ADDRESS_HPP
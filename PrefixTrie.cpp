@@ -0,0 +1,140 @@
+#include "PrefixTrie.hpp"
+
+#include <algorithm>
+
+uint32_t PrefixTrie::newNode(uint32_t prefix, unsigned length, uint64_t count) {
+	m_nodes.push_back(Node{ prefix, length, { kNoNode, kNoNode }, kNoValue, count });
+	return static_cast<uint32_t>(m_nodes.size() - 1U);
+}
+
+uint32_t PrefixTrie::addAt(uint32_t address, unsigned length, uint64_t count) {
+	address = mask(address, length);
+
+	// Nodes are referred to by index, adding one may move the others
+	uint32_t index{ 0U };
+	while (true) {
+		m_nodes[index].count += count;
+		if (m_nodes[index].length == length) {
+			return index;
+		}
+
+		// Nothing after the prefix on the side of the address, the address is a new leaf
+		const unsigned bit{ bitAt(address, m_nodes[index].length) };
+		const uint32_t child{ m_nodes[index].children[bit] };
+		if (child == kNoNode) {
+			const uint32_t leaf{ newNode(address, length, count) };
+			m_nodes[index].children[bit] = leaf;
+			return leaf;
+		}
+
+		// The child is a prefix of the address, go down to it
+		const uint32_t childPrefix{ m_nodes[child].prefix };
+		const unsigned common{ commonLength(address, childPrefix, std::min(length, static_cast<unsigned>(m_nodes[child].length))) };
+		if (common == m_nodes[child].length) {
+			index = child;
+			continue;
+		}
+
+		// The address ends or branches off before the child, put a node where it does above the child
+		const uint32_t fork{ newNode(mask(address, common), common, m_nodes[child].count) };
+		m_nodes[fork].children[bitAt(childPrefix, common)] = child;
+		m_nodes[index].children[bit] = fork;
+		index = fork;
+	}
+}
+
+bool PrefixTrie::insert(uint32_t address, unsigned length, uint32_t value) {
+	Node& node{ m_nodes[addAt(address, length, 0U)] };
+	if (node.value != kNoValue) {
+		return false;
+	}
+	node.value = value;
+	return true;
+}
+
+void PrefixTrie::merge(const PrefixTrie& other) {
+	std::vector<uint32_t> pending{ 0U };
+	while (!pending.empty()) {
+		const Node& node{ other.m_nodes[pending.back()] };
+		pending.pop_back();
+
+		// The count added at the node itself is what its children do not have
+		uint64_t own{ node.count };
+		for (uint32_t child : node.children) {
+			if (child != kNoNode) {
+				own -= other.m_nodes[child].count;
+				pending.push_back(child);
+			}
+		}
+
+		if (own != 0U) {
+			addAt(node.prefix, node.length, own);
+		}
+		if (node.value != kNoValue) {
+			insert(node.prefix, node.length, node.value);
+		}
+	}
+}
+
+uint64_t PrefixTrie::count(uint32_t address, unsigned length) const {
+	address = mask(address, length);
+	const Node* node{ &m_nodes.front() };
+	while (node->length < length) {
+		const uint32_t child{ node->children[bitAt(address, node->length)] };
+		if (child == kNoNode) {
+			return 0U;
+		}
+		node = &m_nodes[child];
+
+		// The prefix ends inside the edge to the child, which covers it if they agree up to its length
+		if (mask(node->prefix, std::min(length, static_cast<unsigned>(node->length))) != mask(address, node->length)) {
+			return 0U;
+		}
+	}
+	return node->count;
+}
+
+uint32_t PrefixTrie::longestMatch(uint32_t address) const {
+	const Node* node{ &m_nodes.front() };
+	uint32_t value{ node->value };
+	while (node->length < kMaxLength) {
+		const uint32_t child{ node->children[bitAt(address, node->length)] };
+		if (child == kNoNode || !matches(m_nodes[child], address)) {
+			break;
+		}
+		node = &m_nodes[child];
+		if (node->value != kNoValue) {
+			value = node->value;
+		}
+	}
+	return value;
+}
+
+std::vector<PrefixTrie::Prefix> PrefixTrie::topPrefixes(unsigned length, size_t n) const {
+	// The first node at or past the length on each path holds every address of one prefix of that length
+	std::vector<Prefix> prefixes;
+	std::vector<uint32_t> pending{ 0U };
+	while (!pending.empty()) {
+		const Node& node{ m_nodes[pending.back()] };
+		pending.pop_back();
+		if (node.length >= length) {
+			if (node.count != 0U) {
+				prefixes.push_back(Prefix{ mask(node.prefix, length), length, node.count });
+			}
+			continue;
+		}
+		for (uint32_t child : node.children) {
+			if (child != kNoNode) {
+				pending.push_back(child);
+			}
+		}
+	}
+
+	auto byCount{ [](const Prefix& lhs, const Prefix& rhs) {
+		return lhs.count > rhs.count || (lhs.count == rhs.count && lhs.address < rhs.address);
+	} };
+	n = std::min(n, prefixes.size());
+	std::partial_sort(prefixes.begin(), prefixes.begin() + n, prefixes.end(), byCount);
+	prefixes.erase(prefixes.begin() + n, prefixes.end());
+	return prefixes;
+}
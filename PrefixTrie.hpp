@@ -0,0 +1,204 @@
+#ifndef PREFIX_TRIE_HPP
+#define PREFIX_TRIE_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/**
+ * Compressed binary trie, or Patricia trie, over the 32 bits of ipv4
+ * addresses. Each node is a prefix, an address and a length, and only the
+ * prefixes where two of the added prefixes branch off get a node, so a trie
+ * of n addresses has fewer than 2n nodes whatever their lengths.
+ *
+ * Every node keeps the total count added at it and below it, which is the
+ * count of its prefix, so the count of any prefix length, such as the /16
+ * and /24 networks, is read off the first node at or past that length
+ * without visiting the addresses under it. Prefixes can also be given a
+ * value, such as the index of a blocklist entry, for longest prefix match.
+ *
+ * The nodes are kept in a vector and refer to each other by index.
+ *
+ * @return PrefixTrie
+ */
+class PrefixTrie {
+public:
+	static constexpr uint32_t kNoValue{ UINT32_MAX }; // Value of the prefixes that were not given one
+	static constexpr unsigned kMaxLength{ 32U }; // Length of a whole address
+
+	/**
+	 * Prefix and its count, as returned by the queries.
+	 */
+	struct Prefix {
+		uint32_t address; // Bits of the prefix, the ones past its length are zero
+		unsigned length; // Number of leading bits of the prefix
+		uint64_t count; // Count of the prefix
+	};
+
+private:
+	static constexpr uint32_t kNoNode{ 0U }; // Child index of no child, the root is never a child
+
+	/**
+	 * Prefix of the trie.
+	 */
+	struct Node {
+		uint32_t prefix; // Bits of the prefix, the ones past its length are zero
+		uint32_t length; // Number of leading bits of the prefix
+		uint32_t children[2]; // Index of the node after a 0 and after a 1 bit at the length, kNoNode if none
+		uint32_t value; // Value given to the prefix, kNoValue if none
+		uint64_t count; // Count added at the prefix and below it
+	};
+
+	std::vector<Node> m_nodes; // Nodes of the trie, the root, the empty prefix, is the first one
+
+	/**
+	* Gets the bit of an address at a position, counting from its most significant bit.
+	*/
+	static unsigned bitAt(uint32_t address, unsigned position) {
+		return (address >> (kMaxLength - 1U - position)) & 1U;
+	}
+
+	/**
+	* Counts the leading bits two addresses have in common.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param maxLength Number of leading bits to compare
+	* @return Number of equal leading bits, at most maxLength
+	*/
+	static unsigned commonLength(uint32_t lhs, uint32_t rhs, unsigned maxLength) {
+		const uint32_t diff{ lhs ^ rhs };
+		if (diff == 0U) {
+			return maxLength;
+		}
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse(&index, static_cast<unsigned long>(diff));
+		const unsigned zeros{ kMaxLength - 1U - static_cast<unsigned>(index) };
+#else
+		const unsigned zeros{ static_cast<unsigned>(__builtin_clz(diff)) };
+#endif
+		return (zeros < maxLength ? zeros : maxLength);
+	}
+
+	/**
+	* Checks if a node is a prefix of an address of at least its length.
+	*/
+	bool matches(const Node& node, uint32_t address) const {
+		return mask(address, node.length) == node.prefix;
+	}
+
+	/**
+	* Appends a node without children.
+	* Time: O(1) amortized
+	* Space: O(1) amortized
+	*
+	* @return Index of the node
+	*/
+	uint32_t newNode(uint32_t prefix, unsigned length, uint64_t count);
+
+	/**
+	* Adds to the count of a prefix and of the ones above it, adding its node and the one where it branches off if they are new.
+	* Time: O(l), l being the length
+	* Space: O(1) amortized
+	*
+	* @return Index of the node of the prefix
+	*/
+	uint32_t addAt(uint32_t address, unsigned length, uint64_t count);
+
+public:
+	/**
+	* Clears the bits of an address past a length.
+	*/
+	static uint32_t mask(uint32_t address, unsigned length) {
+		return (length == 0U ? 0U : address & (UINT32_MAX << (kMaxLength - length)));
+	}
+
+	PrefixTrie() : m_nodes{ Node{ 0U, 0U, { kNoNode, kNoNode }, kNoValue, 0U } } {}
+
+	/**
+	* Adds to the count of an address, and so to the count of every prefix of it.
+	* Time: O(l), l being the depth of the trie, at most 32
+	* Space: O(1) amortized
+	*
+	* @param address Address to count
+	* @param count Count to add
+	*/
+	void add(uint32_t address, uint64_t count = 1U) { addAt(address, kMaxLength, count); }
+
+	/**
+	* Gives a value to a prefix, without changing any count.
+	* Time: O(l)
+	* Space: O(1) amortized
+	*
+	* @param address Address of the prefix, the bits past the length are ignored
+	* @param length Number of leading bits of the prefix, at most 32
+	* @param value Value of the prefix, not kNoValue
+	* @return Wether the prefix had no value before
+	*/
+	bool insert(uint32_t address, unsigned length, uint32_t value);
+
+	/**
+	* Adds the counts and the values of another trie, keeping the values of this one on the prefixes both have.
+	* Time: O(m * l), m being the nodes of the other trie
+	* Space: O(m)
+	*
+	* @param other Trie to add
+	*/
+	void merge(const PrefixTrie& other);
+
+	/**
+	* Gets the count of a prefix.
+	* Time: O(l)
+	* Space: O(1)
+	*
+	* @param address Address of the prefix, the bits past the length are ignored
+	* @param length Number of leading bits of the prefix, at most 32
+	* @return Count added at the prefix and below it
+	*/
+	uint64_t count(uint32_t address, unsigned length) const;
+
+	/**
+	* Gets the value of the longest prefix of an address that was given one.
+	* Time: O(l)
+	* Space: O(1)
+	*
+	* @param address Address to match
+	* @return Value of the longest matching prefix, kNoValue if none matches
+	*/
+	uint32_t longestMatch(uint32_t address) const;
+
+	/**
+	* Gets the prefixes of a length with the highest counts, such as the top /24 networks.
+	* Counts added at shorter prefixes are not in any of them.
+	* Time: O(k + p log n), k being the nodes above the length and p the prefixes with a count
+	* Space: O(p)
+	*
+	* @param length Number of leading bits of the prefixes, at most 32
+	* @param n Maximum number of prefixes to return
+	* @return Prefixes with a count, highest count first, ties by address
+	*/
+	std::vector<Prefix> topPrefixes(unsigned length, size_t n) const;
+
+	/**
+	* Gets the count of every address.
+	*/
+	uint64_t total() const { return m_nodes.front().count; }
+
+	/**
+	* Gets the number of nodes, the root included.
+	*/
+	size_t nodeCount() const { return m_nodes.size(); }
+};
+
+#endif // !PREFIX_TRIE_HPP
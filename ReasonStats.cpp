@@ -0,0 +1,80 @@
+#include "ReasonStats.hpp"
+
+#include <algorithm>
+
+#include "LogParser.hpp"
+
+namespace {
+	/**
+	* Adds to the count of an ID, making room for it the first time it is seen.
+	* Time: O(1) amortized
+	* Space: O(1) amortized
+	*/
+	void addCount(std::vector<uint64_t>& totals, uint32_t id, uint64_t count) {
+		if (id >= totals.size()) {
+			totals.resize(id + 1U, 0U);
+		}
+		totals[id] += count;
+	}
+}
+
+void ReasonStats::add(const PackedAddress& access, std::string_view message) {
+	std::string_view reasonText;
+	std::string_view userText;
+	parseMessage(message, reasonText, userText);
+
+	const uint32_t reason{ m_reasons.intern(reasonText) };
+	addCount(m_reasonTotals, reason, 1U);
+	if (!userText.empty()) {
+		addCount(m_userTotals, m_users.intern(userText), 1U);
+	}
+
+	m_portReasons.upsert(key(access.port(), reason), 1U, [](uint64_t& count) { count++; });
+	m_ipReasons.upsert(key(access.address(), reason), 1U, [](uint64_t& count) { count++; });
+}
+
+void ReasonStats::merge(const ReasonStats& other) {
+	// Map the IDs of the other counts to these, interning the strings seen first there
+	std::vector<uint32_t> reasonIds(other.m_reasons.size());
+	for (uint32_t id{ 0U }; id < reasonIds.size(); ++id) {
+		reasonIds[id] = m_reasons.intern(other.m_reasons.str(id));
+		addCount(m_reasonTotals, reasonIds[id], other.m_reasonTotals[id]);
+	}
+	for (uint32_t id{ 0U }; id < other.m_users.size(); ++id) {
+		addCount(m_userTotals, m_users.intern(other.m_users.str(id)), other.m_userTotals[id]);
+	}
+
+	auto mergeCounts{ [&reasonIds](CountMap& counts, const CountMap& from) {
+		from.forEach([&reasonIds, &counts](const CountMap::Entry& entry) {
+			const uint64_t count{ entry.second };
+			counts.upsert(key(static_cast<uint32_t>(entry.first >> 32), reasonIds[static_cast<uint32_t>(entry.first)]), count, [count](uint64_t& merged) { merged += count; });
+		});
+	} };
+	mergeCounts(m_portReasons, other.m_portReasons);
+	mergeCounts(m_ipReasons, other.m_ipReasons);
+}
+
+uint64_t ReasonStats::portCount(const Port& port, uint32_t reason) const {
+	const auto* entry{ m_portReasons.find(key(port.port(), reason)) };
+	return (entry == nullptr ? 0U : entry->second);
+}
+
+uint64_t ReasonStats::ipCount(const Ip& ip, uint32_t reason) const {
+	const auto* entry{ m_ipReasons.find(key(ip.address(), reason)) };
+	return (entry == nullptr ? 0U : entry->second);
+}
+
+std::vector<std::pair<uint32_t, uint64_t>> ReasonStats::topUsers(size_t n) const {
+	std::vector<std::pair<uint32_t, uint64_t>> users;
+	users.reserve(m_userTotals.size());
+	for (uint32_t id{ 0U }; id < m_userTotals.size(); ++id) {
+		users.emplace_back(id, m_userTotals[id]);
+	}
+	auto byCount{ [](const std::pair<uint32_t, uint64_t>& l, const std::pair<uint32_t, uint64_t>& r) {
+		return l.second > r.second || (l.second == r.second && l.first < r.first);
+	} };
+	n = std::min(n, users.size());
+	std::partial_sort(users.begin(), users.begin() + n, users.end(), byCount);
+	users.erase(users.begin() + n, users.end());
+	return users;
+}
@@ -0,0 +1,127 @@
+#ifndef REASON_STATS_HPP
+#define REASON_STATS_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "NetMap.hpp"
+#include "StringInterner.hpp"
+
+
+/**
+* Counts of the accesses by the reason of the failure, in total, per port and
+* per ip, along with the counts of the user names tried. Reasons and user
+* names are interned, so a line only costs hash lookups once the few
+* distinct reasons and names were seen. The per port and per ip counts are
+* kept in flat maps keyed by the port or address and the reason ID together.
+*
+* @return ReasonStats
+*/
+class ReasonStats {
+	/**
+	 * Hasher of the combined keys.
+	 */
+	struct KeyHasher {
+		size_t operator()(uint64_t key) const { return static_cast<size_t>(PackedAddress::mix(key)); }
+	};
+
+	using CountMap = HashMap<uint64_t, uint64_t, KeyHasher, GroupProbing, NoStats, PowerOfTwoIndex>; // Only looked up, never listed, so the tables can take power of two sizes
+
+	StringInterner m_reasons; // Reason of each reason ID
+	StringInterner m_users; // User name of each user ID
+	std::vector<uint64_t> m_reasonTotals; // Accesses of each reason ID
+	std::vector<uint64_t> m_userTotals; // Accesses of each user ID
+	CountMap m_portReasons; // Accesses of each port and reason
+	CountMap m_ipReasons; // Accesses of each ip and reason
+
+	/**
+	* Combines a port or address with a reason ID into a key of the count maps.
+	*/
+	static uint64_t key(uint32_t value, uint32_t reason) { return (uint64_t{ value } << 32) | reason; }
+
+public:
+	ReasonStats() : m_reasons{}, m_users{}, m_reasonTotals{}, m_userTotals{}, m_portReasons{}, m_ipReasons{} {}
+
+	/**
+	* Counts an access by the reason and user name of its message.
+	* Time: O(n), n being the length of the message
+	* Space: O(1) amortized, O(n) for a new reason or user name
+	*
+	* @param access Ip and port of the access
+	* @param message Message of the log line
+	*/
+	void add(const PackedAddress& access, std::string_view message);
+
+	/**
+	* Adds the counts of another part of the log, whose IDs are mapped to these by their strings.
+	* Time: O(r + u + m), m being the entries of the other count maps
+	* Space: O(r + u + m)
+	*
+	* @param other Counts to add
+	*/
+	void merge(const ReasonStats& other);
+
+	/**
+	* Gets the accesses of a port with a reason.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	uint64_t portCount(const Port& port, uint32_t reason) const;
+
+	/**
+	* Gets the accesses of an ip with a reason.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	uint64_t ipCount(const Ip& ip, uint32_t reason) const;
+
+	/**
+	* Runs a callback on the count of each port and reason pair, in no particular order.
+	* Time: O(m)
+	* Space: O(1)
+	*
+	* @param func Function taking the const Port&, the uint32_t reason ID and the uint64_t count
+	*/
+	template <class CountFunction>
+	void forEachPortReason(CountFunction func) const {
+		m_portReasons.forEach([&func](const CountMap::Entry& entry) {
+			func(Port{ static_cast<uint16_t>(entry.first >> 32) }, static_cast<uint32_t>(entry.first), entry.second);
+		});
+	}
+
+	/**
+	* Gets the user names tried the most.
+	* Time: O(u log u)
+	* Space: O(u)
+	*
+	* @param n Maximum number of user names to return
+	* @return User IDs and their accesses, most accesses first, ties by ID
+	*/
+	std::vector<std::pair<uint32_t, uint64_t>> topUsers(size_t n) const;
+
+	/**
+	* Gets the ID of a reason.
+	*
+	* @return ID of the reason, StringInterner::kNoId if it was never seen
+	*/
+	uint32_t findReason(std::string_view reason) const { return m_reasons.find(reason); }
+
+	std::string_view reason(uint32_t id) const { return m_reasons.str(id); }
+
+	uint64_t reasonTotal(uint32_t id) const { return m_reasonTotals[id]; }
+
+	size_t reasonCount() const { return m_reasons.size(); }
+
+	std::string_view user(uint32_t id) const { return m_users.str(id); }
+
+	size_t userCount() const { return m_users.size(); }
+};
+
+#endif // !REASON_STATS_HPP
@@ -0,0 +1,156 @@
+#include "ReportWriter.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+	// Most lines formatted into one slice, so the buffers stay a few MB however big the map is
+	const size_t MAX_SLICE_LINES{ 1U << 16 };
+
+	// Fewest lines worth a thread of their own
+	const size_t MIN_SLICE_LINES{ 1U << 12 };
+
+	/**
+	 * Consecutive ports of the map formatted into one buffer.
+	 */
+	struct Slice {
+		size_t first; // Index of the first entry
+		size_t last; // Index past the last entry
+	};
+
+	/**
+	* Formats the lines of some ports.
+	* Time: O(n)
+	* Space: O(n)
+	*
+	* @param entries Ports of the map, in its order
+	* @param slice Ports to format
+	* @param [out] buffer Buffer to format into, emptied first
+	*/
+	void formatSlice(const std::vector<const PortMap::Entry*>& entries, Slice slice, ReportBuffer& buffer) {
+		buffer.clear();
+		for (size_t i{ slice.first }; i < slice.last; ++i) {
+			buffer.append(entries[i]->first).append(" : ");
+			entries[i]->second.forEach([&buffer](const IpMap::Entry& entry) {
+				buffer.append(entry.first).append(" : ").appendNumber(entry.second).append('\n');
+			});
+			buffer.append('\n');
+		}
+	}
+}
+
+ReportBuffer& ReportBuffer::appendNumber(uint64_t value) {
+	// 20 digits fit the largest 64 bit number
+	char* first{ reserve(20U) };
+	m_size += static_cast<size_t>(std::to_chars(first, first + 20, value).ptr - first);
+	return *this;
+}
+
+ReportBuffer& ReportBuffer::append(const Ip& ip) {
+	// Four octets of up to three digits and three dots
+	char* first{ reserve(15U) };
+	char* it{ first };
+	for (unsigned i{ 0U }; i < 4U; ++i) {
+		if (i != 0U) {
+			*it++ = '.';
+		}
+		it = std::to_chars(it, it + 3, ip.octet(i)).ptr;
+	}
+	m_size += static_cast<size_t>(it - first);
+	return *this;
+}
+
+ReportBuffer& ReportBuffer::appendJsonString(std::string_view text) {
+	static const char HEX_DIGITS[]{ "0123456789abcdef" };
+	append('"');
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			append('\\').append(c);
+		}
+		else if (static_cast<unsigned char>(c) < 0x20U) {
+			append("\\u00").append(HEX_DIGITS[static_cast<unsigned char>(c) >> 4]).append(HEX_DIGITS[c & 0xF]);
+		}
+		else {
+			append(c);
+		}
+	}
+	return append('"');
+}
+
+ReportWriter::ReportWriter(const std::string& filename) : m_filename{ filename }, m_out{ filename, std::ios::trunc }, m_buffer{} {
+	if (!m_out.is_open()) {
+		throw std::runtime_error{ "Could not open file \"" + m_filename + "\".\n" };
+	}
+}
+
+void ReportWriter::flush() {
+	m_out.write(m_buffer.view().data(), static_cast<std::streamsize>(m_buffer.size()));
+	m_buffer.clear();
+}
+
+void ReportWriter::write(const ReportBuffer& text) {
+	flush();
+	m_out.write(text.view().data(), static_cast<std::streamsize>(text.size()));
+}
+
+void ReportWriter::close() {
+	flush();
+	m_out.close();
+	if (m_out.fail()) {
+		throw std::runtime_error{ "Could not write file \"" + m_filename + "\".\n" };
+	}
+}
+
+void writeNetMap(const std::string& filename, const PortMap& portMap, unsigned numThreads) {
+	if (numThreads == 0U) {
+		numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	// Take the ports in the order of the map, counting the lines of each one
+	std::vector<const PortMap::Entry*> entries;
+	entries.reserve(portMap.size());
+	size_t numLines{ 0U };
+	portMap.forEach([&entries, &numLines](const PortMap::Entry& entry) {
+		entries.push_back(&entry);
+		numLines += entry.second.size();
+	});
+
+	// Cut the ports into slices of about the same number of lines, with enough slices for every thread
+	const size_t numSlices{ std::max({ std::min(size_t{ numThreads }, numLines / MIN_SLICE_LINES), (numLines + MAX_SLICE_LINES - 1U) / MAX_SLICE_LINES, size_t{ 1U } }) };
+	const size_t sliceLines{ (numLines + numSlices - 1U) / numSlices };
+	std::vector<Slice> slices;
+	Slice slice{ 0U, 0U };
+	size_t lines{ 0U };
+	for (; slice.last < entries.size(); ++slice.last) {
+		lines += entries[slice.last]->second.size();
+		if (lines >= sliceLines) {
+			slices.push_back({ slice.first, slice.last + 1U });
+			slice.first = slice.last + 1U;
+			lines = 0U;
+		}
+	}
+	if (slice.first != slice.last || slices.empty()) {
+		slices.push_back(slice);
+	}
+
+	// Format the slices a round of one per thread at a time, the first one on the calling thread, writing each round in order
+	ReportWriter writer{ filename };
+	std::vector<ReportBuffer> buffers(std::min(size_t{ numThreads }, slices.size()));
+	for (size_t round{ 0U }; round < slices.size(); round += buffers.size()) {
+		const size_t roundSize{ std::min(buffers.size(), slices.size() - round) };
+		std::vector<std::thread> workers;
+		for (size_t s{ 1U }; s < roundSize; ++s) {
+			workers.emplace_back([&entries, slice = slices[round + s], &buffer = buffers[s]]() { formatSlice(entries, slice, buffer); });
+		}
+		formatSlice(entries, slices[round], buffers[0]);
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		for (size_t s{ 0U }; s < roundSize; ++s) {
+			writer.write(buffers[s]);
+		}
+	}
+	writer.close();
+}
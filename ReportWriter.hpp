@@ -0,0 +1,178 @@
+#ifndef REPORT_WRITER_HPP
+#define REPORT_WRITER_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "NetMap.hpp"
+
+
+// Size a buffer of a ReportWriter reaches before it is written to the file
+const size_t REPORT_BUFFER_SIZE{ 1U << 20 };
+
+/**
+ * Growable text buffer formatting numbers with std::to_chars, without the
+ * locale and state checks of stream formatting. Clearing it keeps the
+ * memory, so it is reused for the next part of a report.
+ */
+class ReportBuffer {
+	std::string m_text; // Storage, only the first m_size characters are formatted text
+	size_t m_size; // Number of characters formatted
+
+	/**
+	* Makes room for more characters.
+	* Time: O(1) amortized
+	* Space: O(n)
+	*
+	* @param count Number of characters about to be formatted
+	* @return First free character
+	*/
+	char* reserve(size_t count) {
+		if (m_size + count > m_text.size()) {
+			m_text.resize(std::max(m_text.size() * 2U, m_size + count));
+		}
+		return &m_text[m_size];
+	}
+
+public:
+	ReportBuffer() : m_text{}, m_size{ 0U } {}
+
+	/**
+	* Appends text.
+	* Time: O(n)
+	* Space: O(1) amortized
+	*/
+	ReportBuffer& append(std::string_view text) {
+		text.copy(reserve(text.size()), text.size());
+		m_size += text.size();
+		return *this;
+	}
+
+	ReportBuffer& append(char c) {
+		*reserve(1U) = c;
+		m_size++;
+		return *this;
+	}
+
+	/**
+	* Appends a number in decimal.
+	* Time: O(1)
+	* Space: O(1) amortized
+	*/
+	ReportBuffer& appendNumber(uint64_t value);
+
+	/**
+	* Appends an ip as its dotted octets.
+	* Time: O(1)
+	* Space: O(1) amortized
+	*/
+	ReportBuffer& append(const Ip& ip);
+
+	ReportBuffer& append(const Port& port) { return appendNumber(port.port()); }
+
+	/**
+	* Appends text as a JSON string, between quotes and with the characters JSON needs escaped.
+	* Time: O(n)
+	* Space: O(1) amortized
+	*/
+	ReportBuffer& appendJsonString(std::string_view text);
+
+	/**
+	* Empties the buffer, keeping its memory.
+	*/
+	void clear() { m_size = 0U; }
+
+	size_t size() const { return m_size; }
+
+	std::string_view view() const { return { m_text.data(), m_size }; }
+};
+
+/**
+ * Report file written in a few large writes. The text is formatted into a
+ * buffer, which is written out once it holds REPORT_BUFFER_SIZE characters,
+ * and buffers formatted elsewhere are written whole.
+ */
+class ReportWriter {
+	std::string m_filename; // Name of the file, for the errors
+	std::ofstream m_out; // Open file
+	ReportBuffer m_buffer; // Text not written yet
+
+public:
+	/**
+	* Opens a report file in text mode, replacing its contents, so its lines
+	* end the way the text files of the platform do.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param filename Name of the file
+	* @throw std::runtime_error If the file could not be opened
+	*/
+	explicit ReportWriter(const std::string& filename);
+
+	/**
+	* Gets the buffer to format the report into.
+	*/
+	ReportBuffer& buffer() { return m_buffer; }
+
+	/**
+	* Writes the buffer out if it is full.
+	* Time: O(n)
+	* Space: O(1)
+	*/
+	void flushIfFull() {
+		if (m_buffer.size() >= REPORT_BUFFER_SIZE) {
+			flush();
+		}
+	}
+
+	/**
+	* Writes the buffer out.
+	* Time: O(n)
+	* Space: O(1)
+	*/
+	void flush();
+
+	/**
+	* Writes a buffer formatted elsewhere after the text of this one.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param text Buffer to write
+	*/
+	void write(const ReportBuffer& text);
+
+	/**
+	* Writes the rest of the buffer and closes the file.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @throw std::runtime_error If the file could not be written
+	*/
+	void close();
+};
+
+/**
+* Writes every port of a port map, with the count of each of its ips, as
+* "port : ip : count" followed by "ip : count" lines and an empty line,
+* the same text as printing the map to a stream. The ports are split into slices of about
+* the same number of lines, formatted on several threads into buffers that
+* are reused for the next slices, and written in the order of the map.
+* Time: O(n / t)
+* Space: O(t), the buffers of the slices
+*
+* @param filename Name of the file
+* @param portMap Map to write
+* @param numThreads Number of threads to format with, 0 for one per hardware thread
+* @throw std::runtime_error If the file could not be written
+*/
+void writeNetMap(const std::string& filename, const PortMap& portMap, unsigned numThreads = 0U);
+
+#endif // !REPORT_WRITER_HPP
@@ -0,0 +1,182 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "fileio.hpp"
+
+namespace {
+	// First bytes of every snapshot file
+	const char SNAPSHOT_MAGIC[8]{ 'N', 'E', 'T', 'M', 'A', 'P', 'S', 'S' };
+
+	// Written as a native integer, reads differently on machines of the other byte order
+	const uint32_t BYTE_ORDER_MARK{ 0x01020304U };
+
+	// Buckets per entry a map can grow to past its initial buckets, the maps about double when they are full
+	const uint64_t MAX_BUCKETS_PER_ENTRY{ 4U };
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t portBucketCount;
+		uint64_t numPorts;
+		uint64_t numIps;
+		uint64_t logBytes;
+		uint64_t logPrefixHash;
+	};
+
+	struct PortRecord {
+		uint16_t port;
+		uint16_t reserved;
+		uint32_t numConnections;
+		uint32_t numIps;
+		uint32_t ipBucketCount;
+	};
+
+	struct IpRecord {
+		uint32_t address;
+		uint32_t count;
+	};
+
+	static_assert(sizeof(SnapshotHeader) == 56U && sizeof(PortRecord) == 16U && sizeof(IpRecord) == 8U, "Snapshot records must not have padding");
+
+	/**
+	* Writes a record as raw bytes.
+	*/
+	template <class Record>
+	void writeRecord(std::ofstream& out, const Record& record) {
+		out.write(reinterpret_cast<const char*>(&record), sizeof(Record));
+	}
+
+	/**
+	* Copies a record out of the mapping, which does not need to be aligned for it.
+	*/
+	template <class Record>
+	Record readRecord(const char* data) {
+		Record record;
+		std::memcpy(&record, data, sizeof(Record));
+		return record;
+	}
+}
+
+uint64_t hashLogPrefix(std::string_view text, uint64_t size) {
+	// FNV-1a over the bytes, then mixed
+	uint64_t h{ 0xCBF29CE484222325ULL };
+	const size_t count{ static_cast<size_t>(std::min({ size, LOG_PREFIX_SIZE, uint64_t{ text.size() } })) };
+	for (size_t i{ 0U }; i < count; ++i) {
+		h = (h ^ static_cast<unsigned char>(text[i])) * 0x100000001B3ULL;
+	}
+	return PackedAddress::mix(h);
+}
+
+void saveSnapshot(const std::string& filename, const PortMap& portMap, const SnapshotInfo& info) {
+	const std::string tempFilename{ filename + ".tmp" };
+	std::ofstream out{ tempFilename, std::ios::binary | std::ios::trunc };
+	if (!out.is_open()) {
+		throw std::runtime_error{ "Could not open file \"" + tempFilename + "\".\n" };
+	}
+
+	SnapshotHeader header{};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.portBucketCount = portMap.bucket_count();
+	header.numPorts = portMap.size();
+	portMap.forEach([&header](const PortMap::Entry& entry) { header.numIps += entry.second.size(); });
+	header.logBytes = info.logBytes;
+	header.logPrefixHash = info.logPrefixHash;
+	writeRecord(out, header);
+
+	// Ports first, then the ips of all of them, so both arrays are contiguous
+	portMap.forEach([&out](const PortMap::Entry& entry) {
+		const IpMap& ipMap{ entry.second };
+		writeRecord(out, PortRecord{ entry.first.port(), 0U, ipMap.getNumConnections(), static_cast<uint32_t>(ipMap.size()), static_cast<uint32_t>(ipMap.bucket_count()) });
+	});
+	portMap.forEach([&out](const PortMap::Entry& entry) {
+		entry.second.forEach([&out](const IpMap::Entry& ipEntry) {
+			writeRecord(out, IpRecord{ ipEntry.first.address(), ipEntry.second });
+		});
+	});
+
+	out.close();
+	if (out.fail()) {
+		throw std::runtime_error{ "Could not write file \"" + tempFilename + "\".\n" };
+	}
+
+	// Replace the old snapshot, removing it first since renaming over a file fails on Windows
+	std::remove(filename.c_str());
+	if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		throw std::runtime_error{ "Could not rename file \"" + tempFilename + "\".\n" };
+	}
+}
+
+bool loadSnapshot(const std::string& filename, PortMap& portMap, SnapshotInfo& info) {
+	if (!std::ifstream{ filename, std::ios::binary }.is_open()) {
+		return false;
+	}
+
+	const fio::MappedFile file{ filename.c_str() };
+	const char* data{ file.data() };
+	const auto invalid{ [&filename](const char* reason) {
+		return std::runtime_error{ "Invalid snapshot \"" + filename + "\": " + reason + ".\n" };
+	} };
+
+	// Check the header before trusting any of the counts
+	if (file.size() < sizeof(SnapshotHeader)) {
+		throw invalid("too short");
+	}
+	const SnapshotHeader header{ readRecord<SnapshotHeader>(data) };
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+		throw invalid("not a snapshot");
+	}
+	if (header.byteOrder != BYTE_ORDER_MARK) {
+		throw invalid("written with another byte order");
+	}
+	if (header.version != SNAPSHOT_VERSION) {
+		throw invalid(("version " + std::to_string(header.version) + " instead of " + std::to_string(SNAPSHOT_VERSION)).c_str());
+	}
+	if (header.numPorts > (file.size() - sizeof(SnapshotHeader)) / sizeof(PortRecord) ||
+		header.numIps != (file.size() - sizeof(SnapshotHeader) - header.numPorts * sizeof(PortRecord)) / sizeof(IpRecord) ||
+		(file.size() - sizeof(SnapshotHeader) - header.numPorts * sizeof(PortRecord)) % sizeof(IpRecord) != 0U) {
+		throw invalid("size does not match its counts");
+	}
+	if (header.portBucketCount > MAX_BUCKETS_PER_ENTRY * header.numPorts + PORT_MAP_SIZE) {
+		throw invalid("more port buckets than its ports need");
+	}
+
+	// Size the map as it was saved, so the replayed insertions land in the same buckets and order
+	portMap.rehash(static_cast<size_t>(header.portBucketCount));
+	const char* portData{ data + sizeof(SnapshotHeader) };
+	const char* ipData{ portData + header.numPorts * sizeof(PortRecord) };
+	uint64_t ipsLeft{ header.numIps };
+	for (uint64_t p{ 0U }; p < header.numPorts; ++p) {
+		const PortRecord port{ readRecord<PortRecord>(portData + p * sizeof(PortRecord)) };
+		if (port.numIps > ipsLeft) {
+			throw invalid("more ips than it holds");
+		}
+		ipsLeft -= port.numIps;
+		if (port.ipBucketCount > MAX_BUCKETS_PER_ENTRY * port.numIps + IP_MAP_SIZE) {
+			throw invalid("more ip buckets than its ips need");
+		}
+
+		auto res{ portMap.try_emplace(Port{ port.port }) };
+		if (!res.first) {
+			throw invalid("repeated port");
+		}
+		IpMap& ipMap{ res.second->second };
+		ipMap.addNumConnections(port.numConnections);
+		ipMap.rehash(port.ipBucketCount);
+		for (uint32_t i{ 0U }; i < port.numIps; ++i, ipData += sizeof(IpRecord)) {
+			const IpRecord ip{ readRecord<IpRecord>(ipData) };
+			ipMap.insert(Ip{ ip.address }, ip.count);
+		}
+	}
+
+	info.logBytes = header.logBytes;
+	info.logPrefixHash = header.logPrefixHash;
+	return true;
+}
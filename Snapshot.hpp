@@ -0,0 +1,90 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "NetMap.hpp"
+
+
+/**
+ * Binary snapshot of an aggregated PortMap, so a restarted process loads the
+ * counts instead of parsing the whole log again.
+ *
+ * The file is a fixed size header, followed by one record per port in the
+ * iteration order of the map, followed by the records of the ips of every
+ * port, in the same order. Records have fixed sizes and are read straight
+ * from a mapping of the file. The map is rebuilt with the bucket counts it
+ * was saved with and the entries inserted in their saved order, without any
+ * growth in progress. The counts are the same as the saved ones, but a map
+ * that was growing when it was saved can iterate in another order.
+ *
+ * The header also records how many bytes of the log the counts cover, with
+ * a hash of the start of the log, so new lines appended to the same log can
+ * be ingested on top of the loaded map.
+ *
+ * Version 1 layout, in the byte order of the machine that wrote it:
+ *   header  magic "NETMAPSS", uint32 version, uint32 byte order mark, uint64 port bucket count,
+ *           uint64 ports, uint64 ips, uint64 log bytes, uint64 log prefix hash
+ *   ports   uint16 port, uint16 reserved, uint32 connections, uint32 ips, uint32 ip bucket count
+ *   ips     uint32 address, uint32 count
+ */
+
+// Current version of the snapshot format
+const uint32_t SNAPSHOT_VERSION{ 1U };
+
+// Number of bytes at the start of a log hashed to recognize it
+const uint64_t LOG_PREFIX_SIZE{ 4096U };
+
+/**
+ * Part of the log covered by a snapshot.
+ */
+struct SnapshotInfo {
+	uint64_t logBytes; // Number of bytes of the log ingested into the map
+	uint64_t logPrefixHash; // Hash of the first bytes of the log, to tell if it is still the same log
+};
+
+/**
+* Hashes the first bytes of a log, which stay the same while lines are appended to it.
+* Time: O(1)
+* Space: O(1)
+*
+* @param text Contents of the log
+* @param size Number of bytes covered by a snapshot, only up to the first LOG_PREFIX_SIZE of them are hashed
+* @return Hash of the bytes
+*/
+uint64_t hashLogPrefix(std::string_view text, uint64_t size);
+
+/**
+* Writes a snapshot of a port map. It is written to a temporary file first and
+* then renamed over the old snapshot, so a crash never leaves a partial one.
+* Time: O(n)
+* Space: O(1)
+*
+* @param filename Name of the snapshot file
+* @param portMap Map to save
+* @param info Part of the log covered by the map
+* @throw std::runtime_error If the file could not be written
+*/
+void saveSnapshot(const std::string& filename, const PortMap& portMap, const SnapshotInfo& info);
+
+/**
+* Loads a snapshot of a port map.
+* Time: O(n)
+* Space: O(n)
+*
+* @param filename Name of the snapshot file
+* @param [out] portMap Map to fill, must be empty
+* @param [out] info Part of the log covered by the map
+* @throw std::runtime_error If the file is not a valid snapshot of this version and byte order
+* @return Wether the snapshot file exists
+*/
+bool loadSnapshot(const std::string& filename, PortMap& portMap, SnapshotInfo& info);
+
+#endif // !SNAPSHOT_HPP
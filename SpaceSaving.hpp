@@ -0,0 +1,279 @@
+#ifndef SPACE_SAVING_HPP
+#define SPACE_SAVING_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "HashMap.hpp"
+
+/**
+ * Bounded memory summary of the most frequent keys of a stream, using the
+ * Space-Saving algorithm. It monitors at most a fixed number of keys. A
+ * key that is not monitored takes the counter of the least counted one,
+ * inheriting its count as the possible overestimation of its own.
+ *
+ * For every monitored key, count - error <= true count <= count, and the
+ * error is at most total / capacity. A key that is not monitored was seen
+ * at most minCount() times, so every key seen more than total / capacity
+ * times is always monitored.
+ *
+ * The counters are kept in a binary min heap on the count, with a HashMap
+ * from each key to its position in the heap.
+ *
+ * @param K Type of the key
+ * @param Hasher Struct with overloaded operator() as with hash function
+ */
+template <class K, class Hasher = std::hash<K>>
+class SpaceSaving {
+public:
+	/**
+	 * Estimated count of a monitored key.
+	 */
+	struct Counter {
+		K key; // Monitored key
+		uint64_t count; // Upper bound of the number of times the key was seen
+		uint64_t error; // Maximum overestimation of the count
+
+		/**
+		* Gets the lower bound of the number of times the key was seen.
+		*/
+		uint64_t guaranteed() const { return count - error; }
+	};
+
+private:
+	size_t m_capacity; // Maximum number of monitored keys
+	std::vector<Counter> m_heap; // Counters, as a min heap on the count
+	HashMap<K, size_t, Hasher> m_positions; // Position of each monitored key in the heap
+	uint64_t m_total; // Total weight added
+
+	/**
+	* Moves a counter up the heap until its parent is not greater.
+	* Time: O(log k)
+	* Space: O(1)
+	*/
+	void siftUp(size_t i);
+
+	/**
+	* Moves a counter down the heap until its children are not smaller.
+	* Time: O(log k)
+	* Space: O(1)
+	*/
+	void siftDown(size_t i);
+
+	/**
+	* Swaps two counters of the heap, updating their positions.
+	*/
+	void swapCounters(size_t i, size_t j);
+
+public:
+	/**
+	* Constructor of the summary.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param capacity Maximum number of monitored keys, at least one
+	*/
+	explicit SpaceSaving(size_t capacity) : m_capacity{ std::max(capacity, size_t{ 1U }) }, m_heap{}, m_positions{}, m_total{ 0U } {}
+
+	/**
+	* Counts occurrences of a key.
+	* Time: O(log k)
+	* Space: O(1)
+	*
+	* @param key Key seen
+	* @param weight Number of occurrences
+	*/
+	void add(const K& key, uint64_t weight = 1U) { add(key, weight, [](const K&) {}); }
+
+	/**
+	* Counts occurrences of a key, telling which key stops being monitored if one does.
+	* Time: O(log k)
+	* Space: O(1)
+	*
+	* @param key Key seen
+	* @param weight Number of occurrences
+	* @param onEvict Function taking the const K& key whose counter is taken over, called before it is
+	*/
+	template <class EvictFunction>
+	void add(const K& key, uint64_t weight, EvictFunction onEvict);
+
+	/**
+	* Adds the counters of a summary of another part of the stream, keeping the
+	* ones with the highest counts. The error bounds hold for the merged stream.
+	* Time: O(k log k)
+	* Space: O(k)
+	*
+	* @param other Summary to add
+	*/
+	void merge(const SpaceSaving& other);
+
+	/**
+	* Gets the monitored keys with the highest counts.
+	* Time: O(k log k)
+	* Space: O(k)
+	*
+	* @param n Maximum number of keys to return
+	* @return Counters sorted by count, highest first, ties by lowest error and then by key
+	*/
+	std::vector<Counter> top(size_t n) const;
+
+	/**
+	* Gets the number of times a key not monitored could have been seen,
+	* which is also the maximum error of any monitored key.
+	* Time: O(1)
+	* Space: O(1)
+	*/
+	uint64_t minCount() const { return (m_heap.size() < m_capacity ? 0U : m_heap.front().count); }
+
+	/**
+	 * Runs a callback on each counter, in no particular order.
+	 * Time: O(k)
+	 * Space: O(1)
+	 *
+	 * @param func Unary function that takes a const Counter& as parameter
+	 */
+	template <class UnaryFunction>
+	void forEach(UnaryFunction func) const {
+		for (const Counter& counter : m_heap) {
+			func(counter);
+		}
+	}
+
+	size_t capacity() const { return m_capacity; }
+
+	size_t size() const { return m_heap.size(); }
+
+	uint64_t total() const { return m_total; }
+};
+
+template<class K, class Hasher>
+template<class EvictFunction>
+inline void SpaceSaving<K, Hasher>::add(const K& key, uint64_t weight, EvictFunction onEvict) {
+	m_total += weight;
+
+	// Monitored key, its count only grows
+	auto res{ m_positions.try_emplace(key, m_heap.size()) };
+	if (!res.first) {
+		const size_t i{ res.second->second };
+		m_heap[i].count += weight;
+		siftDown(i);
+		return;
+	}
+
+	// Free counter, the count is exact
+	if (m_heap.size() < m_capacity) {
+		m_heap.push_back({ key, weight, 0U });
+		siftUp(m_heap.size() - 1U);
+		return;
+	}
+
+	// Take over the least counted key, which could have been this one every time
+	res.second->second = 0U;
+	Counter& min{ m_heap.front() };
+	onEvict(min.key);
+	m_positions.erase(min.key);
+	min.key = key;
+	min.error = min.count;
+	min.count += weight;
+	siftDown(0U);
+}
+
+template<class K, class Hasher>
+inline void SpaceSaving<K, Hasher>::merge(const SpaceSaving& other) {
+	const uint64_t minThis{ minCount() };
+	const uint64_t minOther{ other.minCount() };
+	m_total += other.m_total;
+
+	// A key missing from one of the summaries could have been seen up to its minimum count there
+	std::vector<Counter> merged{ m_heap };
+	std::vector<bool> inOther(merged.size(), false);
+	for (const Counter& counter : other.m_heap) {
+		const auto* position{ m_positions.find(counter.key) };
+		if (position == nullptr) {
+			merged.push_back({ counter.key, counter.count + minThis, counter.error + minThis });
+		}
+		else {
+			merged[position->second].count += counter.count;
+			merged[position->second].error += counter.error;
+			inOther[position->second] = true;
+		}
+	}
+	for (size_t i{ 0U }; i < inOther.size(); ++i) {
+		if (!inOther[i]) {
+			merged[i].count += minOther;
+			merged[i].error += minOther;
+		}
+	}
+
+	// Keep the highest counts
+	if (merged.size() > m_capacity) {
+		std::nth_element(merged.begin(), merged.begin() + (m_capacity - 1U), merged.end(),
+			[](const Counter& l, const Counter& r) { return l.count > r.count; });
+		merged.erase(merged.begin() + m_capacity, merged.end());
+	}
+
+	// Rebuild the heap and the positions
+	std::make_heap(merged.begin(), merged.end(), [](const Counter& l, const Counter& r) { return l.count > r.count; });
+	m_heap = std::move(merged);
+	m_positions = HashMap<K, size_t, Hasher>{};
+	for (size_t i{ 0U }; i < m_heap.size(); ++i) {
+		m_positions.insert(m_heap[i].key, i);
+	}
+}
+
+template<class K, class Hasher>
+inline std::vector<typename SpaceSaving<K, Hasher>::Counter> SpaceSaving<K, Hasher>::top(size_t n) const {
+	std::vector<Counter> counters{ m_heap };
+	auto byCount{ [](const Counter& l, const Counter& r) {
+		return l.count > r.count || (l.count == r.count && (l.error < r.error || (l.error == r.error && l.key < r.key)));
+	} };
+	n = std::min(n, counters.size());
+	std::partial_sort(counters.begin(), counters.begin() + n, counters.end(), byCount);
+	counters.erase(counters.begin() + n, counters.end());
+	return counters;
+}
+
+template<class K, class Hasher>
+inline void SpaceSaving<K, Hasher>::siftUp(size_t i) {
+	while (i != 0U) {
+		const size_t parent{ (i - 1U) / 2U };
+		if (m_heap[parent].count <= m_heap[i].count) {
+			break;
+		}
+		swapCounters(i, parent);
+		i = parent;
+	}
+}
+
+template<class K, class Hasher>
+inline void SpaceSaving<K, Hasher>::siftDown(size_t i) {
+	for (;;) {
+		size_t smallest{ i };
+		for (size_t child : { 2U * i + 1U, 2U * i + 2U }) {
+			if (child < m_heap.size() && m_heap[child].count < m_heap[smallest].count) {
+				smallest = child;
+			}
+		}
+		if (smallest == i) {
+			break;
+		}
+		swapCounters(i, smallest);
+		i = smallest;
+	}
+}
+
+template<class K, class Hasher>
+inline void SpaceSaving<K, Hasher>::swapCounters(size_t i, size_t j) {
+	std::swap(m_heap[i], m_heap[j]);
+	m_positions.find(m_heap[i].key)->second = i;
+	m_positions.find(m_heap[j].key)->second = j;
+}
+
+#endif // !SPACE_SAVING_HPP
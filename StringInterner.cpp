@@ -0,0 +1,35 @@
+#include "StringInterner.hpp"
+
+#include <algorithm>
+
+std::string_view StringInterner::store(std::string_view text) {
+	// Start a new block when the string does not fit, of its own size if it is longer than a block
+	if (m_blocks.empty() || text.size() > STRING_ARENA_BLOCK_SIZE - m_blockUsed) {
+		m_blocks.emplace_back(new char[std::max(text.size(), STRING_ARENA_BLOCK_SIZE)]);
+		m_blockUsed = 0U;
+	}
+
+	char* copy{ m_blocks.back().get() + m_blockUsed };
+	text.copy(copy, text.size());
+	m_blockUsed = std::min(m_blockUsed + text.size(), STRING_ARENA_BLOCK_SIZE);
+	return { copy, text.size() };
+}
+
+uint32_t StringInterner::intern(std::string_view text) {
+	// Seen before, only hashed and compared
+	const auto* entry{ m_ids.find(text) };
+	if (entry != nullptr) {
+		return entry->second;
+	}
+
+	const uint32_t id{ static_cast<uint32_t>(m_strings.size()) };
+	const std::string_view copy{ store(text) };
+	m_strings.push_back(copy);
+	m_ids.insert(copy, id);
+	return id;
+}
+
+uint32_t StringInterner::find(std::string_view text) const {
+	const auto* entry{ m_ids.find(text) };
+	return (entry == nullptr ? kNoId : entry->second);
+}
@@ -0,0 +1,92 @@
+#ifndef STRING_INTERNER_HPP
+#define STRING_INTERNER_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "HashMapInternalChaining.hpp"
+
+
+// Size of the blocks the interned strings are copied into
+const size_t STRING_ARENA_BLOCK_SIZE{ 1U << 16 };
+
+/**
+ * Table of distinct strings, each one given a small integer ID in the order
+ * they are first seen. The characters are copied into large arena blocks
+ * that never move, and a HashMapInternalChaining from the views of the
+ * copies to their IDs finds the strings seen before. Interning a string
+ * seen before only hashes and compares it, without allocating.
+ *
+ * @return StringInterner
+ */
+class StringInterner {
+public:
+	static constexpr uint32_t kNoId{ UINT32_MAX }; // ID of no string
+
+private:
+	std::vector<std::unique_ptr<char[]>> m_blocks; // Arena blocks holding the characters
+	size_t m_blockUsed; // Number of characters used of the last block
+	std::vector<std::string_view> m_strings; // Copy of each string, by ID
+	HashMapInternalChaining<std::string_view, uint32_t> m_ids; // ID of each string, keyed by its copy
+
+	/**
+	* Copies a string into the arena.
+	* Time: O(n)
+	* Space: O(n)
+	*
+	* @param text String to copy
+	* @return View of the copy
+	*/
+	std::string_view store(std::string_view text);
+
+public:
+	StringInterner() : m_blocks{}, m_blockUsed{ STRING_ARENA_BLOCK_SIZE }, m_strings{}, m_ids{} {}
+
+	// The views of the table point into the arena, so the interner moves but does not copy
+	StringInterner(const StringInterner&) = delete;
+	StringInterner& operator=(const StringInterner&) = delete;
+	StringInterner(StringInterner&&) = default;
+	StringInterner& operator=(StringInterner&&) = default;
+
+	/**
+	* Gets the ID of a string, giving it the next one if it was not seen before.
+	* Time: O(n)
+	* Space: O(n) for a new string, O(1) else
+	*
+	* @param text String to intern
+	* @return ID of the string
+	*/
+	uint32_t intern(std::string_view text);
+
+	/**
+	* Gets the ID of a string without interning it.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param text String to look for
+	* @return ID of the string, kNoId if it was not interned
+	*/
+	uint32_t find(std::string_view text) const;
+
+	/**
+	* Gets the string of an ID.
+	*
+	* @param id ID given by intern, less than size()
+	* @return The interned copy of the string
+	*/
+	std::string_view str(uint32_t id) const { return m_strings[id]; }
+
+	/**
+	* Gets the number of distinct strings, which is also the next ID.
+	*/
+	size_t size() const { return m_strings.size(); }
+};
+
+#endif // !STRING_INTERNER_HPP
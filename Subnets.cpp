@@ -0,0 +1,80 @@
+#include "Subnets.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "fileio.hpp"
+#include "LogParser.hpp"
+
+bool Blocklist::add(uint32_t address, unsigned length) {
+	const uint32_t index{ static_cast<uint32_t>(m_networks.size()) };
+	if (!m_trie.insert(address, length, index)) {
+		return false;
+	}
+	m_networks.emplace_back(PrefixTrie::mask(address, length), length);
+	return true;
+}
+
+Blocklist loadBlocklist(const std::string& filename) {
+	std::ifstream in{ filename };
+	if (!in.is_open()) {
+		throw std::runtime_error{ "Could not open file \"" + filename + "\".\n" };
+	}
+
+	Blocklist blocklist;
+	size_t lineNumber{ 0U };
+	fio::forEachLine(in, [&blocklist, &lineNumber, &filename](std::string_view line) {
+		++lineNumber;
+		const size_t first{ line.find_first_not_of(" \t\r") };
+		if (first == std::string_view::npos || line[first] == '#') {
+			return;
+		}
+		line = line.substr(first, line.find_last_not_of(" \t\r") + 1U - first);
+
+		uint32_t address;
+		unsigned length;
+		if (!parsePrefix(line, address, length)) {
+			std::cerr << "[WARNING] Skipping malformed network on line " << lineNumber << " of '" << filename << "': '" << line << "'" << std::endl;
+			return;
+		}
+		blocklist.add(address, length);
+	});
+	return blocklist;
+}
+
+SubnetMap::SubnetMap(const Blocklist* blocklist) :
+	m_ports{},
+	m_blocklist{ blocklist },
+	m_blocked(blocklist == nullptr ? 0U : blocklist->size(), 0U),
+	m_accesses{ 0U }
+{}
+
+void SubnetMap::add(const PackedAddress& access, uint64_t count) {
+	const auto entry{ getIpAndPortFromAccess(access) };
+	m_ports.try_emplace(entry.first).second->second.add(entry.second.address(), count);
+	m_accesses += count;
+
+	if (m_blocklist != nullptr) {
+		const uint32_t network{ m_blocklist->match(entry.second) };
+		if (network != PrefixTrie::kNoValue) {
+			m_blocked[network] += count;
+		}
+	}
+}
+
+void SubnetMap::merge(const SubnetMap& other) {
+	other.m_ports.forEach([this](const PortTries::Entry& entry) {
+		m_ports.try_emplace(entry.first).second->second.merge(entry.second);
+	});
+
+	for (size_t i{ 0U }; i < m_blocked.size() && i < other.m_blocked.size(); ++i) {
+		m_blocked[i] += other.m_blocked[i];
+	}
+	m_accesses += other.m_accesses;
+}
+
+const PrefixTrie* SubnetMap::find(const Port& port) const {
+	const auto* entry{ m_ports.find(port) };
+	return (entry == nullptr ? nullptr : &entry->second);
+}
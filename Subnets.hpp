@@ -0,0 +1,154 @@
+#ifndef SUBNETS_HPP
+#define SUBNETS_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "NetMap.hpp"
+#include "PrefixTrie.hpp"
+
+
+/**
+* Networks to look the ips of the accesses up in, each one given an index in
+* the order it was added. An ip is matched to the longest network that
+* contains it, so a /24 inside a listed /16 is counted on its own.
+*
+* @return Blocklist
+*/
+class Blocklist {
+	PrefixTrie m_trie; // Networks, valued by their index
+	std::vector<std::pair<uint32_t, unsigned>> m_networks; // Address and length of each network, by index
+
+public:
+	Blocklist() : m_trie{}, m_networks{} {}
+
+	/**
+	* Adds a network.
+	* Time: O(l)
+	* Space: O(1) amortized
+	*
+	* @param address Address of the network, the bits past the length are ignored
+	* @param length Number of leading bits of the network, at most 32
+	* @return Wether the network was not in the list, it keeps its first index else
+	*/
+	bool add(uint32_t address, unsigned length);
+
+	/**
+	* Gets the longest network that contains an ip.
+	* Time: O(l)
+	* Space: O(1)
+	*
+	* @return Index of the network, PrefixTrie::kNoValue if no network contains the ip
+	*/
+	uint32_t match(const Ip& ip) const { return m_trie.longestMatch(ip.address()); }
+
+	uint32_t address(uint32_t index) const { return m_networks[index].first; }
+
+	unsigned length(uint32_t index) const { return m_networks[index].second; }
+
+	size_t size() const { return m_networks.size(); }
+
+	bool empty() const { return m_networks.empty(); }
+};
+
+/**
+* Reads a blocklist file with one network per line in CIDR notation, such as
+* "80.169.0.0/16", or a single ip. Empty lines and lines starting with '#'
+* are skipped, and so are malformed ones after a warning on std::cerr.
+* Time: O(n)
+* Space: O(b)
+*
+* @param filename Name of the file
+* @throw std::runtime_error If the file could not be opened
+* @return Networks of the file
+*/
+Blocklist loadBlocklist(const std::string& filename);
+
+/**
+* Prefix tries of the ips of each port, which give the counts of the
+* networks the accesses of a port come from at every prefix length, such as
+* its top /16 and /24 networks, without going over its ips again. When given
+* a blocklist, each access is also matched to its longest blocklist network
+* as it is counted.
+*
+* @return SubnetMap
+*/
+class SubnetMap {
+public:
+	using PortTries = HashMap<Port, PrefixTrie, Port::Hasher>;
+
+private:
+	PortTries m_ports; // Trie of the ips of each port
+	const Blocklist* m_blocklist; // Networks to match the ips to, nullptr for none
+	std::vector<uint64_t> m_blocked; // Accesses whose longest matching network is each blocklist network
+	uint64_t m_accesses; // Number of accesses
+
+public:
+	/**
+	* Constructor of the map.
+	* Time: O(b)
+	* Space: O(b)
+	*
+	* @param blocklist Networks to match the ips to, nullptr for none. It must outlive the map
+	*/
+	explicit SubnetMap(const Blocklist* blocklist = nullptr);
+
+	/**
+	* Counts the accesses of an ip to a port. Adding the ips of a port in
+	* address order keeps the nodes the trie goes through in cache.
+	* Time: O(l), l being the depth of the trie of the port, at most 32
+	* Space: O(1) amortized
+	*
+	* @param access Ip and port of the accesses
+	* @param count Number of accesses
+	*/
+	void add(const PackedAddress& access, uint64_t count = 1U);
+
+	/**
+	* Adds the counts of another part of the log, matched to the same blocklist.
+	* Time: O(m * l), m being the trie nodes of the other map
+	* Space: O(m)
+	*
+	* @param other Counts to add
+	*/
+	void merge(const SubnetMap& other);
+
+	/**
+	* Gets the trie of the ips of a port.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @return Trie of the port, nullptr if the port has no accesses
+	*/
+	const PrefixTrie* find(const Port& port) const;
+
+	/**
+	* Runs a callback on the trie of each port, in no particular order.
+	* Time: O(p)
+	* Space: O(1)
+	*
+	* @param func Function taking the const Port& and its const PrefixTrie&
+	*/
+	template <class PortFunction>
+	void forEachPort(PortFunction func) const {
+		m_ports.forEach([&func](const PortTries::Entry& entry) { func(entry.first, entry.second); });
+	}
+
+	const Blocklist* blocklist() const { return m_blocklist; }
+
+	/**
+	* Gets the accesses whose longest matching network is a blocklist network.
+	*/
+	uint64_t blocked(uint32_t index) const { return m_blocked[index]; }
+
+	uint64_t accesses() const { return m_accesses; }
+};
+
+#endif // !SUBNETS_HPP
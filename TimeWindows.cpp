@@ -0,0 +1,181 @@
+#include "TimeWindows.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	/**
+	* Sorts counts by count, highest first, and then by key.
+	* Time: O(n log n)
+	* Space: O(1)
+	*/
+	template <class Key>
+	void sortByCount(std::vector<std::pair<Key, uint64_t>>& counts) {
+		std::sort(counts.begin(), counts.end(), [](const std::pair<Key, uint64_t>& l, const std::pair<Key, uint64_t>& r) {
+			return l.second > r.second || (l.second == r.second && l.first < r.first);
+		});
+	}
+
+	/**
+	* Empties the table of an expired slot for reuse. A table with many more buckets than the entries
+	* it held is swapped for a new one, so clearing never costs much more than filling it did.
+	* Time: O(n + k)
+	* Space: O(1)
+	*
+	* @param maxSparseness Buckets per entry above which the table is dropped
+	* @param keptBuckets Buckets the table can have and be cleared anyway
+	*/
+	template <class Counts>
+	void resetCounts(Counts& counts, size_t maxSparseness, size_t keptBuckets) {
+		if (counts.bucket_count() > std::max(keptBuckets, maxSparseness * counts.size())) {
+			counts = Counts{};
+		}
+		else {
+			counts.clear();
+		}
+	}
+}
+
+TimeWindows::TimeWindows(uint32_t slotSeconds, size_t slotCount) : m_slotSeconds{ std::max(slotSeconds, 1U) }, m_slots{}, m_newest{ kNoSlot }, m_expired{ 0U } {
+	m_slots.reserve(std::max(slotCount, size_t{ 1U }));
+	for (size_t i{ 0U }; i < m_slots.capacity(); ++i) {
+		m_slots.push_back({ kNoSlot, 0U, PortCounts{}, PairCounts{} });
+	}
+}
+
+void TimeWindows::advance(uint32_t number) {
+	// Only the slots passed over can hold counts that fall out of the history, their tables are reset on reuse
+	if (!empty()) {
+		const uint32_t passed{ static_cast<uint32_t>(std::min(uint64_t{ number - m_newest }, uint64_t{ m_slots.size() })) };
+		for (uint32_t n{ m_newest + 1U }; n != m_newest + 1U + passed; ++n) {
+			Slot& slot{ m_slots[n % m_slots.size()] };
+			if (slot.number != kNoSlot) {
+				m_expired += slot.accesses;
+				slot.number = kNoSlot;
+			}
+		}
+	}
+	m_newest = number;
+}
+
+TimeWindows::Slot& TimeWindows::useSlot(uint32_t number) {
+	// Every slot in the history is either empty, expired or holds its own slot number
+	Slot& slot{ m_slots[number % m_slots.size()] };
+	if (slot.number != number) {
+		slot.number = number;
+		slot.accesses = 0U;
+		resetCounts(slot.ports, kMaxSparseness, kKeptBuckets);
+		resetCounts(slot.pairs, kMaxSparseness, kKeptBuckets);
+	}
+	return slot;
+}
+
+uint32_t TimeWindows::windowStart(uint32_t windowSeconds) const {
+	const uint64_t slots{ std::min(std::max((uint64_t{ windowSeconds } + m_slotSeconds - 1U) / m_slotSeconds, uint64_t{ 1U }), uint64_t{ m_slots.size() }) };
+	return (m_newest + 1U >= slots ? static_cast<uint32_t>(m_newest + 1U - slots) : 0U);
+}
+
+bool TimeWindows::add(uint32_t time, const PackedAddress& access) {
+	const uint32_t number{ time / m_slotSeconds };
+	if (empty() || number > m_newest) {
+		advance(number);
+	}
+	else if (m_newest - number >= m_slots.size()) {
+		m_expired++;
+		return false;
+	}
+
+	Slot& slot{ useSlot(number) };
+	slot.accesses++;
+	slot.ports.upsert(Port{ access.port() }, 1U, [](uint64_t& count) { count++; });
+	slot.pairs.upsert(access, 1U, [](uint64_t& count) { count++; });
+	return true;
+}
+
+void TimeWindows::merge(const TimeWindows& other) {
+	if (other.m_slotSeconds != m_slotSeconds || other.m_slots.size() != m_slots.size()) {
+		throw std::invalid_argument{ "TimeWindows with different slots cannot be merged" };
+	}
+	m_expired += other.m_expired;
+	if (other.empty()) {
+		return;
+	}
+	if (empty() || other.m_newest > m_newest) {
+		advance(other.m_newest);
+	}
+
+	// Add the slots of the other windows that are still in the merged history
+	for (const Slot& from : other.m_slots) {
+		if (from.number == kNoSlot) {
+			continue;
+		}
+		if (m_newest - from.number >= m_slots.size()) {
+			m_expired += from.accesses;
+			continue;
+		}
+
+		Slot& slot{ useSlot(from.number) };
+		slot.accesses += from.accesses;
+		from.ports.forEach([&slot](const PortCounts::Entry& entry) {
+			const uint64_t count{ entry.second };
+			slot.ports.upsert(entry.first, count, [count](uint64_t& merged) { merged += count; });
+		});
+		from.pairs.forEach([&slot](const PairCounts::Entry& entry) {
+			const uint64_t count{ entry.second };
+			slot.pairs.upsert(entry.first, count, [count](uint64_t& merged) { merged += count; });
+		});
+	}
+}
+
+std::vector<std::pair<Port, uint64_t>> TimeWindows::topPorts(uint32_t windowSeconds, size_t n) const {
+	if (empty()) {
+		return {};
+	}
+
+	// Add up the counts of the slots of the window
+	PortCounts totals;
+	for (uint32_t number{ windowStart(windowSeconds) }; number <= m_newest; ++number) {
+		const Slot& slot{ m_slots[number % m_slots.size()] };
+		if (slot.number != number) {
+			continue;
+		}
+		slot.ports.forEach([&totals](const PortCounts::Entry& entry) {
+			const uint64_t count{ entry.second };
+			totals.upsert(entry.first, count, [count](uint64_t& total) { total += count; });
+		});
+	}
+
+	std::vector<std::pair<Port, uint64_t>> counts;
+	counts.reserve(totals.size());
+	totals.forEach([&counts](const PortCounts::Entry& entry) { counts.emplace_back(entry.first, entry.second); });
+	sortByCount(counts);
+	counts.erase(counts.begin() + std::min(n, counts.size()), counts.end());
+	return counts;
+}
+
+std::vector<std::pair<Ip, uint64_t>> TimeWindows::ips(const Port& port, uint32_t windowSeconds) const {
+	if (empty()) {
+		return {};
+	}
+
+	// Add up the counts of the pairs of the port in the slots of the window
+	HashMap<Ip, uint64_t, Ip::Hasher> totals;
+	for (uint32_t number{ windowStart(windowSeconds) }; number <= m_newest; ++number) {
+		const Slot& slot{ m_slots[number % m_slots.size()] };
+		if (slot.number != number) {
+			continue;
+		}
+		slot.pairs.forEach([&port, &totals](const PairCounts::Entry& entry) {
+			if (entry.first.port() == port.port()) {
+				const uint64_t count{ entry.second };
+				totals.upsert(Ip{ entry.first.address() }, count, [count](uint64_t& total) { total += count; });
+			}
+		});
+	}
+
+	std::vector<std::pair<Ip, uint64_t>> counts;
+	counts.reserve(totals.size());
+	totals.forEach([&counts](const HashMap<Ip, uint64_t, Ip::Hasher>::Entry& entry) { counts.emplace_back(entry.first, entry.second); });
+	sortByCount(counts);
+	return counts;
+}
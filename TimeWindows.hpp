@@ -0,0 +1,167 @@
+#ifndef TIME_WINDOWS_HPP
+#define TIME_WINDOWS_HPP
+
+// Pedro Escoboza
+// A01251531
+// TCB1004.500
+// 21/11/2020
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "NetMap.hpp"
+
+
+// Length of a time slot in seconds
+const uint32_t TIME_SLOT_SECONDS{ 60U };
+
+// Number of time slots kept, one day of minutes
+const size_t TIME_SLOT_COUNT{ 24U * 60U };
+
+/**
+* Counts of the accesses of each port, and of each port and ip pair, in
+* time slots, such as one per minute, over the latest part of the log, such
+* as its last day. The slots are a ring indexed by slot number, so moving
+* on to a new slot only marks the slot that falls out of the history as
+* expired, and the counts of any window of the latest slots are added up
+* from its slots without touching the rest. An expired slot keeps its
+* tables until it is reused, which clears them, or drops them if a busier
+* minute grew them far past what they held.
+*
+* The clock is the newest timestamp seen, so the lines do not need to be
+* in order. Accesses older than the history, whether they come late or
+* their slot is cleared, are only counted as expired. Windows of parts of
+* a log are merged by adding up the slots the merged history keeps, which
+* gives the same counts as adding the whole log to one set of windows.
+*
+* @return TimeWindows
+*/
+class TimeWindows {
+public:
+	// The counts are sorted before they are reported, so the tables can take power of two sizes
+	using PortCounts = HashMap<Port, uint64_t, Port::Hasher, GroupProbing, NoStats, PowerOfTwoIndex>;
+	using PairCounts = HashMap<PackedAddress, uint64_t, PackedAddress::Hasher, GroupProbing, NoStats, PowerOfTwoIndex>;
+
+private:
+	static constexpr uint32_t kNoSlot{ UINT32_MAX }; // Slot number of a slot with no counts
+	static constexpr size_t kMaxSparseness{ 8U }; // Buckets per entry held above which a reused table is dropped rather than cleared
+	static constexpr size_t kKeptBuckets{ 1024U }; // Buckets a reused table is cleared with whatever it held
+
+	/**
+	 * Counts of one time slot.
+	 */
+	struct Slot {
+		uint32_t number; // Time divided by the slot length, kNoSlot if the slot is empty or expired
+		uint64_t accesses; // Number of accesses counted in the slot
+		PortCounts ports; // Accesses of each port, stale if the slot is expired
+		PairCounts pairs; // Accesses of each port and ip pair, stale if the slot is expired
+	};
+
+	uint32_t m_slotSeconds; // Length of a slot in seconds
+	std::vector<Slot> m_slots; // Ring of slots, slot number n is at n % size
+	uint32_t m_newest; // Number of the newest slot, kNoSlot before the first access
+	uint64_t m_expired; // Number of accesses older than the history
+
+	/**
+	* Moves the clock forward to a newer slot, expiring the slots that fall out of the history.
+	* Their tables are left to be reset when the slots are reused.
+	* Time: O(s), s being the slots passed
+	* Space: O(1)
+	*
+	* @param number Number of the new newest slot
+	*/
+	void advance(uint32_t number);
+
+	/**
+	* Gets the slot of a slot number in the history, resetting it first if it holds an expired slot.
+	* Time: O(1) amortized, the entries of the expired slot are cleared at the cost of adding them
+	* Space: O(1)
+	*
+	* @param number Number of the slot
+	* @return Slot holding the number
+	*/
+	Slot& useSlot(uint32_t number);
+
+	/**
+	* Gets the first slot number of a window ending at the newest slot.
+	* Time: O(1)
+	* Space: O(1)
+	*
+	* @param windowSeconds Length of the window in seconds, rounded up to whole slots and cut to the history
+	* @return Number of the oldest slot of the window
+	*/
+	uint32_t windowStart(uint32_t windowSeconds) const;
+
+public:
+	/**
+	* Constructor of the windows.
+	* Time: O(c)
+	* Space: O(c)
+	*
+	* @param slotSeconds Length of a slot in seconds, at least one
+	* @param slotCount Number of slots of history, at least one
+	*/
+	explicit TimeWindows(uint32_t slotSeconds = TIME_SLOT_SECONDS, size_t slotCount = TIME_SLOT_COUNT);
+
+	/**
+	* Counts an access.
+	* Time: O(1) amortized
+	* Space: O(1) amortized
+	*
+	* @param time Seconds since the start of the year of the access, as given by parseTimestamp
+	* @param access Ip and port of the access
+	* @return Wether it is in the history, instead of being older
+	*/
+	bool add(uint32_t time, const PackedAddress& access);
+
+	/**
+	* Adds the counts of the windows of another part of the log.
+	* Time: O(c + m), m being the entries of the slots of the other windows
+	* Space: O(m)
+	*
+	* @param other Windows to add, with the same slot length and count
+	* @throw std::invalid_argument If the slot lengths or counts differ
+	*/
+	void merge(const TimeWindows& other);
+
+	/**
+	* Gets the ports with the most accesses in the latest part of the history.
+	* Time: O(w * p + p log p), w being the slots of the window and p their ports
+	* Space: O(p)
+	*
+	* @param windowSeconds Length of the window in seconds, ending at the newest slot
+	* @param n Maximum number of ports to return
+	* @return Ports and their accesses in the window, most accessed first, ties by port
+	*/
+	std::vector<std::pair<Port, uint64_t>> topPorts(uint32_t windowSeconds, size_t n) const;
+
+	/**
+	* Gets the accesses of each ip of a port in the latest part of the history.
+	* Time: O(w * m + i log i), w being the slots of the window, m their pairs and i the ips
+	* Space: O(i)
+	*
+	* @param port Port to look at
+	* @param windowSeconds Length of the window in seconds, ending at the newest slot
+	* @return Ips and their accesses in the window, most accesses first, ties by ip
+	*/
+	std::vector<std::pair<Ip, uint64_t>> ips(const Port& port, uint32_t windowSeconds) const;
+
+	/**
+	* Checks if any access was counted.
+	*/
+	bool empty() const { return m_newest == kNoSlot; }
+
+	/**
+	* Gets the end of the newest slot, in seconds since the start of the year.
+	*/
+	uint64_t end() const { return (empty() ? 0U : (uint64_t{ m_newest } + 1U) * m_slotSeconds); }
+
+	uint64_t expired() const { return m_expired; }
+
+	uint32_t slotSeconds() const { return m_slotSeconds; }
+
+	size_t slotCount() const { return m_slots.size(); }
+};
+
+#endif // !TIME_WINDOWS_HPP
@@ -6,6 +6,21 @@
 
 #include "fileio.hpp"
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace fio {
 	std::vector<std::string> readLines(const char* t_filename, unsigned t_numLines){
 		std::ifstream ifstream;
@@ -41,4 +56,113 @@ namespace fio {
 
 		return stream;
 	}
+
+#ifdef _WIN32
+	MappedFile::MappedFile(const char* t_filename) : m_data{ nullptr }, m_size{ 0U }, m_file{ INVALID_HANDLE_VALUE }, m_mapping{ nullptr } {
+		m_file = CreateFileA(t_filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error(std::string{ "Could not open file \"" + std::string{t_filename } +"\".\n" });
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			CloseHandle(m_file);
+			throw std::runtime_error(std::string{ "Could not get the size of file \"" + std::string{t_filename } +"\".\n" });
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+
+		// Empty files cannot be mapped, they are left as an empty view
+		if (m_size == 0U) {
+			return;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* view{ m_mapping == nullptr ? nullptr : MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) };
+		if (view == nullptr) {
+			if (m_mapping != nullptr) {
+				CloseHandle(m_mapping);
+			}
+			CloseHandle(m_file);
+			throw std::runtime_error(std::string{ "Could not map file \"" + std::string{t_filename } +"\".\n" });
+		}
+		m_data = static_cast<const char*>(view);
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_data != nullptr) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping != nullptr) {
+			CloseHandle(m_mapping);
+		}
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+		}
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept : m_data{ nullptr }, m_size{ 0U }, m_file{ INVALID_HANDLE_VALUE }, m_mapping{ nullptr } {
+		swap(other);
+	}
+
+	void MappedFile::swap(MappedFile& other) noexcept {
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+	}
+#else
+	MappedFile::MappedFile(const char* t_filename) : m_data{ nullptr }, m_size{ 0U }, m_fd{ -1 } {
+		m_fd = open(t_filename, O_RDONLY);
+		if (m_fd == -1) {
+			throw std::runtime_error(std::string{ "Could not open file \"" + std::string{t_filename } +"\".\n" });
+		}
+
+		struct stat info;
+		if (fstat(m_fd, &info) == -1) {
+			close(m_fd);
+			throw std::runtime_error(std::string{ "Could not get the size of file \"" + std::string{t_filename } +"\".\n" });
+		}
+		m_size = static_cast<size_t>(info.st_size);
+
+		// Empty files cannot be mapped, they are left as an empty view
+		if (m_size == 0U) {
+			return;
+		}
+
+		void* view{ mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0) };
+		if (view == MAP_FAILED) {
+			close(m_fd);
+			throw std::runtime_error(std::string{ "Could not map file \"" + std::string{t_filename } +"\".\n" });
+		}
+
+		// The file is read front to back, let the kernel read ahead aggressively
+		madvise(view, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const char*>(view);
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_data != nullptr) {
+			munmap(const_cast<char*>(m_data), m_size);
+		}
+		if (m_fd != -1) {
+			close(m_fd);
+		}
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept : m_data{ nullptr }, m_size{ 0U }, m_fd{ -1 } {
+		swap(other);
+	}
+
+	void MappedFile::swap(MappedFile& other) noexcept {
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_fd, other.m_fd);
+	}
+#endif
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+		MappedFile moved{ std::move(other) };
+		swap(moved);
+		return *this;
+	}
 }
\ No newline at end of file
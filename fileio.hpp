@@ -7,9 +7,12 @@
 #ifndef FILE_IO_HPP
 #define FILE_IO_HPP
 
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <vector>
 #include <stdexcept>
@@ -18,6 +21,122 @@ namespace fio {
 	std::vector<std::string> readLines(const char* t_filename, unsigned t_numLines = 0U);
 
 	std::stringstream readFile(const char* t_filename);
+
+	/**
+	 * Read only memory mapping of a whole file.
+	 * The pages are loaded by the kernel on first access and read ahead
+	 * sequentially, so the file is processed while it is being read and
+	 * the mapped pages can be dropped again under memory pressure.
+	 */
+	class MappedFile {
+		const char* m_data; // First byte of the mapping
+		size_t m_size; // Size of the file in bytes
+#ifdef _WIN32
+		void* m_file; // Handle of the open file
+		void* m_mapping; // Handle of the file mapping
+#else
+		int m_fd; // Descriptor of the open file
+#endif
+
+	public:
+		/**
+		 * Maps a file for reading.
+		 * Time: O(1)
+		 * Space: O(1)
+		 *
+		 * @param t_filename Name of the file
+		 * @throw std::runtime_error If the file could not be opened or mapped
+		 * @return MappedFile
+		 */
+		explicit MappedFile(const char* t_filename);
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		const char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		std::string_view view() const { return { m_data, m_size }; }
+
+		void swap(MappedFile& other) noexcept;
+	};
+
+	/**
+	* Calls a function on each line of a text, without copying the lines.
+	* The line breaks, including a carriage return before them, are not part of the lines.
+	* Time: O(n)
+	* Space: O(1)
+	*
+	* @param t_text Text to split
+	* @param t_func Function taking a std::string_view line
+	*/
+	template <class Func>
+	void forEachLine(std::string_view t_text, Func t_func) {
+		const char* it{ t_text.data() };
+		const char* end{ t_text.data() + t_text.size() };
+		while (it != end) {
+			const char* lineEnd{ static_cast<const char*>(std::memchr(it, '\n', static_cast<size_t>(end - it))) };
+			const char* next{ lineEnd == nullptr ? end : lineEnd + 1 };
+			if (lineEnd == nullptr) {
+				lineEnd = end;
+			}
+			if (lineEnd != it && *(lineEnd - 1) == '\r') {
+				--lineEnd;
+			}
+			t_func(std::string_view{ it, static_cast<size_t>(lineEnd - it) });
+			it = next;
+		}
+	}
+
+	/**
+	* Calls a function on each line of a stream, reading it in fixed size chunks.
+	* Used for inputs that cannot be mapped, such as pipes. Only the chunk and
+	* the line that crosses its end are held in memory.
+	* Time: O(n)
+	* Space: O(c + l), c being the chunk size and l the longest line
+	*
+	* @param t_in Stream to read
+	* @param t_func Function taking a std::string_view line
+	* @param t_chunkSize Number of bytes read at once
+	*/
+	template <class Func>
+	void forEachLine(std::istream& t_in, Func t_func, size_t t_chunkSize = 1U << 20) {
+		std::unique_ptr<char[]> chunk{ new char[t_chunkSize] };
+		std::string carry; // Start of a line that continues in the next chunk
+		while (t_in) {
+			t_in.read(chunk.get(), static_cast<std::streamsize>(t_chunkSize));
+			const size_t count{ static_cast<size_t>(t_in.gcount()) };
+			if (count == 0U) {
+				break;
+			}
+
+			// Complete the carried line with the start of this chunk
+			std::string_view text{ chunk.get(), count };
+			if (!carry.empty()) {
+				const size_t lineEnd{ text.find('\n') };
+				if (lineEnd == std::string_view::npos) {
+					carry.append(text.data(), text.size());
+					continue;
+				}
+				carry.append(text.data(), lineEnd + 1U);
+				forEachLine(std::string_view{ carry }, t_func);
+				carry.clear();
+				text.remove_prefix(lineEnd + 1U);
+			}
+
+			// Pass the complete lines and carry the last partial one
+			const size_t lastEnd{ text.rfind('\n') };
+			if (lastEnd == std::string_view::npos) {
+				carry.assign(text.data(), text.size());
+				continue;
+			}
+			forEachLine(text.substr(0U, lastEnd + 1U), t_func);
+			carry.assign(text.data() + lastEnd + 1U, text.size() - lastEnd - 1U);
+		}
+		forEachLine(std::string_view{ carry }, t_func);
+	}
 };
 
 #endif // !FILE_IO_HPP
\ No newline at end of file
@@ -3,261 +3,328 @@
 // TCB1004.500
 // 21/11/2020
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <thread>
 #include <vector>
 
 #include "Timer.hpp"
 #include "fileio.hpp"
-#include "IpAddress.hpp"
-#include "HashMapInternalChaining.hpp"
+#include "NetMap.hpp"
+#include "Ingest.hpp"
+#include "Snapshot.hpp"
+#include "ReportWriter.hpp"
+#include "LogFollower.hpp"
+#include "AccessIndex.hpp"
+#include "LogParser.hpp"
 
 
 const char* INPUT_FILE{ "bitacora3.txt" };
 const char* MOST_ACCESSED_PORT_OUTFILE{"most_accessed_port.json"};
 const char* NET_MAP_OUTPUT_FILE{ "net_map.txt" };
+const char* MAP_STATS_OUTPUT_FILE{ "map_stats.json" };
+const char* WINDOW_PORT_OUTPUT_FILE{ "window_port.json" };
+const char* REASONS_OUTPUT_FILE{ "reasons.json" };
+const char* SUBNETS_OUTPUT_FILE{ "subnets.json" };
+const char* RANGE_QUERY_OUTPUT_FILE{ "range_query.json" };
 
+// Number of ports listed in the summary of the heavy hitter mode
+const size_t NUM_REPORTED_TOP_PORTS{ 10U };
 
-// Vector of prime numbers to use as dynamic bucket counts for the port map
-const std::vector<size_t> PRIMES{
-	 7U,
-	 63U,
-	 511U,
-	 1023U,
-	 2047U,
-	 4095U,
-	 8191U,
-	 16383U,
-	 32767U,
-	 65535U,
-	 131071U,
-	 262143U,
-	 524287U,
-	 1048575U,
-	 2097151U,
-	 4194303U,
-	 8388607U,
-	 16777215U
+// Number of user names listed in the report of the failure reason mode
+const size_t NUM_REPORTED_TOP_USERS{ 10U };
+
+// Number of networks of each prefix length listed in the report of the subnet mode
+const size_t NUM_REPORTED_TOP_NETWORKS{ 10U };
+
+// Prefix lengths of the networks listed in the report of the subnet mode
+const unsigned REPORTED_NETWORK_LENGTHS[]{ 16U, 24U };
+
+// Time between polls of a followed log
+const std::chrono::milliseconds FOLLOW_POLL_INTERVAL{ 250 };
+
+/**
+ * Options of a run, given on the command line.
+ */
+struct Options {
+	unsigned numThreads; // Number of ingestion threads, 0 for one per hardware thread, "--threads N"
+	bool flat; // Wether to count the accesses in a FlatNetMap and build the port map from it, "--flat"
+	bool stats; // Wether to also write the statistics of the maps, "--stats"
+	std::string snapshot; // Snapshot file to start from and to save the port map to, empty for none, "--snapshot FILE"
+	unsigned followInterval; // Seconds between the most accessed port reports of a followed log, 0 to read it once, "--follow SECONDS"
+	unsigned windowMinutes; // Minutes of the time window mode, 0 to build the port map, "--window MINUTES"
+	size_t numTopPorts; // Number of ports of the bounded memory summary mode, 0 to build the port map, "--top N"
+	unsigned distinctIpsPrecision; // Register index bits of the distinct ip sketches of the summary mode, 0 for none, "--distinct P"
+	bool reasons; // Wether to count the accesses by failure reason instead of building the port map, "--reasons"
+	bool subnets; // Wether to count the networks of the ips of each port instead of building the port map, "--subnets"
+	int subnetPort; // Port whose networks the subnet mode reports, -1 for the most accessed one, "--port N"
+	std::string blocklist; // Networks the subnet mode matches the ips to, empty for none, "--blocklist FILE"
+	std::string ipRange; // Ips whose accesses are listed from the port map, empty for none, "--ip-range FIRST-LAST|NETWORK"
+	std::string portRange; // Ports whose accesses are listed from the port map, empty for none, "--port-range FIRST-LAST"
 };
 
-// Bucket count of the ip maps
-const size_t IP_MAP_SIZE{ PRIMES[1] };
 
 /**
-* Calculates the size needed for the bucket count.
-* Time: O(n)
-* Space: O(1)
-* 
-* @param size Number of elements to store in the hash map
-* @param table Vector of prime sizes for bucket count
-* @return Minimum prime bucket count from the table given that matches the size
+* Writes the table shapes of the port map and of all its ip maps together, with
+* their operation totals when NetMapStats records them.
+*
+* @param portMap Map to report
 */
-size_t getBucketCount(size_t size, const std::vector<size_t>& table = PRIMES ) {
-
-	for (const auto& s : table) {
-		if (s >= size) {
-			return s;
-		}
+void writeMapStats(const PortMap& portMap) {
+	std::ofstream statsOutFile{ MAP_STATS_OUTPUT_FILE };
+	if (!statsOutFile.is_open()) {
+		std::cerr << "[ERROR] Could not open file '" << MAP_STATS_OUTPUT_FILE << "'" << std::endl;
+		std::exit(1);
 	}
 
-	return table[table.size() - 1];
+	TableStats ipTables{ true };
+	NetMapStats ipOperations;
+	portMap.forEach([&ipTables, &ipOperations](const PortMap::Entry& entry) {
+		ipTables.merge(entry.second.tableStats());
+		ipOperations.merge(entry.second.operationStats());
+	});
+
+	statsOutFile << "{\n    \"portMap\": ";
+	writeStatsJson(statsOutFile, portMap.tableStats(), portMap.operationStats(), 8U);
+	statsOutFile << ",\n    \"ipMaps\": ";
+	writeStatsJson(statsOutFile, ipTables, ipOperations, 8U);
+	statsOutFile << "\n}";
 }
 
 /**
-* Helper to parse the ip from the file line
-* 
-* @return String of the ip and port from the file line
-*/ 
-std::string parseIpStr(const std::string& line) {
-	// Get the file line into a stream to output tokens
-	std::istringstream fullLine{ line };
-
+* Appends the accesses of a range of an AccessIndex to a report, as a JSON object.
+*
+* @param out Buffer of the report
+* @param writer Writer of the buffer, flushed as the accesses are appended
+* @param count Pairs and accesses of the range
+* @param forEachPair Function running its callback argument on the pairs of the range
+*/
+template <class RangeFunction>
+void appendRange(ReportBuffer& out, ReportWriter& writer, const RangeCount& count, RangeFunction forEachPair) {
+	out.append("\"pairs\": \"").appendNumber(count.pairs).append("\",\n")
+		.append("        \"numberConnections\": \"").appendNumber(count.accesses).append("\",\n")
+		.append("        \"accesses\": [");
+	bool first{ true };
+	forEachPair([&out, &writer, &first](const PackedAddress& pair, unsigned numConnections) {
+		out.append(first ? "\n" : ",\n").append("            { \"ip\": \"").append(Ip{ pair.address() })
+			.append("\", \"port\": \"").append(Port{ pair.port() }).append("\", \"numberConnections\": \"").appendNumber(numConnections).append("\" }");
+		writer.flushIfFull();
+		first = false;
+	});
+	out.append(first ? "]\n" : "\n        ]\n");
+}
 
-	// Throw away unsused information
-	{
-		std::string str;
-		fullLine >> str;
-		fullLine >> str;
-		fullLine >> str;
+/**
+* Writes the accesses of the ip range and of the port range of the options,
+* looked up in a sorted index of the port map instead of a scan of it.
+*
+* @param portMap Map to index
+* @param options Options of the run, with an ip range, a port range or both
+* @throw std::invalid_argument If a range is malformed
+*/
+void writeRangeQuery(const PortMap& portMap, const Options& options) {
+	uint32_t firstIp{ 0U };
+	uint32_t lastIp{ 0U };
+	if (!options.ipRange.empty() && !parseIpRange(options.ipRange, firstIp, lastIp)) {
+		throw std::invalid_argument{ "Malformed ip range '" + options.ipRange + "'\n" };
+	}
+	uint16_t firstPort{ 0U };
+	uint16_t lastPort{ 0U };
+	if (!options.portRange.empty() && !parsePortRange(options.portRange, firstPort, lastPort)) {
+		throw std::invalid_argument{ "Malformed port range '" + options.portRange + "'\n" };
 	}
 
-	// Extract the ip string
-	std::string ipStr;
-	fullLine >> ipStr;
-
-	return ipStr;
+	const AccessIndex index{ portMap };
+	ReportWriter rangeOutFile{ RANGE_QUERY_OUTPUT_FILE };
+	ReportBuffer& out{ rangeOutFile.buffer() };
+	out.append("{");
+	if (!options.ipRange.empty()) {
+		out.append("\n    \"ips\": {\n        \"first\": \"").append(Ip{ firstIp }).append("\",\n")
+			.append("        \"last\": \"").append(Ip{ lastIp }).append("\",\n        ");
+		appendRange(out, rangeOutFile, index.countIps(firstIp, lastIp), [&index, firstIp, lastIp](auto func) { index.forEachIp(firstIp, lastIp, func); });
+		out.append("    }").append(options.portRange.empty() ? "" : ",");
+	}
+	if (!options.portRange.empty()) {
+		out.append("\n    \"ports\": {\n        \"first\": \"").append(Port{ firstPort }).append("\",\n")
+			.append("        \"last\": \"").append(Port{ lastPort }).append("\",\n        ");
+		appendRange(out, rangeOutFile, index.countPorts(firstPort, lastPort), [&index, firstPort, lastPort](auto func) { index.forEachPort(firstPort, lastPort, func); });
+		out.append("    }");
+	}
+	out.append("\n}");
+	rangeOutFile.close();
 }
 
-
 /**
-* Extends the IpAddress class to represent an input connection from an ipv4.
-* 
-* @return Ip
+* Loads the snapshot of the log if there is one that covers part of it.
+*
+* @param filename Name of the snapshot file
+* @param log Contents of the log
+* @param [out] portMap Map to load the snapshot into, must be empty
+* @return Number of bytes of the log covered by the loaded snapshot, 0 if none was loaded
 */
-class Ip : public IpAddress {
-
-public:
-	struct Hasher {
-		
-		size_t operator()(const Ip& ip) const {
-			return s_hasher(ip.str());
-		}
-
-	private:
-		static std::hash<std::string> s_hasher;
-	};
-	
-	Ip(unsigned part_1, unsigned part_2, unsigned part_3, unsigned part_4) : IpAddress{ part_1, part_2, part_3, part_4, 0U } {}
-
-	friend std::ostream& operator<<(std::ostream& out, const Ip& ip) {
-		out << ip.m_part1 << '.' << ip.m_part2 << '.' << ip.m_part3 << '.' << ip.m_part4;
-		return out;
+size_t loadLogSnapshot(const std::string& filename, std::string_view log, PortMap& portMap) {
+	SnapshotInfo info{};
+	if (!loadSnapshot(filename, portMap, info)) {
+		return 0U;
 	}
-};
 
-std::hash<std::string> Ip::Hasher::s_hasher{};
+	// A log shorter than the snapshot or with another start was rotated or replaced
+	if (info.logBytes > log.size() || hashLogPrefix(log, info.logBytes) != info.logPrefixHash) {
+		std::cerr << "[WARNING] Snapshot '" << filename << "' is not of the current log, ingesting it all again" << std::endl;
+		portMap = PortMap{};
+		return 0U;
+	}
+	return static_cast<size_t>(info.logBytes);
+}
 
 /**
-* Extends the IpAddress to represent an access port in the server.
-* 
-* @return Port
+* Writes the most accessed port report.
+*
+* @param mostAccessedPortEntry Port with the most connections and its ips
 */
-class Port : public IpAddress {
+void writeMostAccessedPort(const PortMap::Entry& mostAccessedPortEntry) {
+	const size_t maxNumConnections{ mostAccessedPortEntry.second.getNumConnections() };
 
-public:
-	struct Hasher {
-
-		size_t operator()(const Port& ip) const {
-			return s_hasher(ip.str());
+	// Print the port summary to the file in json format
+	ReportWriter portOutFile{ MOST_ACCESSED_PORT_OUTFILE };
+	ReportBuffer& out{ portOutFile.buffer() };
+	out.append("{\n    \"mostAccessedPort\": \"").append(mostAccessedPortEntry.first).append("\",\n")
+		.append("    \"numberConnections\": \"").appendNumber(maxNumConnections).append("\",\n")
+		.append("    \"ips\": {\n");
+	size_t commaCounter{maxNumConnections};
+	mostAccessedPortEntry.second.forEach(
+		[&portOutFile, &out, &commaCounter](const IpMap::Entry& entry) {
+			commaCounter -= entry.second;
+			out.append("        \"").append(entry.first).append("\": ").appendNumber(entry.second).append(commaCounter != 0 ? ",\n" : "\n");
+			portOutFile.flushIfFull();
 		}
+	);
+	out.append("    }\n}");
+		
+	// Close the outpu file
+	portOutFile.close();
+}
 
-	private: 
-		static std::hash<std::string> s_hasher;
-	};
-
-
-	Port(unsigned port) : IpAddress{ 0U, 0U, 0U, 0U, port} {}
-
-	friend std::ostream& operator<<(std::ostream& out, const Port& port) {
-		out << port.m_port;
-		return out;
-	}
+/**
+* Follows the log as it grows, polling it for new lines and calling a report
+* function at every interval. Runs until the process is stopped.
+*
+* @param options Options of the run
+* @param logBytes Number of bytes of the log read so far, ending with a line break
+* @param logPrefixHash Hash of those bytes, as given by hashLogPrefix
+* @param onLines Function taking the std::string_view new lines of each poll that has some
+* @param onReport Function called at every interval
+*/
+template <class LinesFunction, class ReportFunction>
+void followLog(const Options& options, uint64_t logBytes, uint64_t logPrefixHash, LinesFunction onLines, ReportFunction onReport) {
+	LogFollower follower{ INPUT_FILE, logBytes, logPrefixHash };
+	const std::chrono::seconds interval{ options.followInterval };
+	auto nextReport{ std::chrono::steady_clock::now() + interval };
+	for (;;) {
+		std::this_thread::sleep_for(FOLLOW_POLL_INTERVAL);
+
+		bool rotated{ false };
+		const std::string_view lines{ follower.poll(rotated) };
+		if (rotated) {
+			std::cerr << "[WARNING] Log '" << INPUT_FILE << "' was rotated, following the new one from its start" << std::endl;
+		}
+		if (!lines.empty()) {
+			onLines(lines);
+		}
 
-	friend bool operator==(const Port& l, const Port& r) {
-		return l.m_port == r.m_port;
+		const auto now{ std::chrono::steady_clock::now() };
+		if (now >= nextReport) {
+			nextReport = now + interval;
+			onReport();
+		}
 	}
-};
-
-std::hash<std::string> Port::Hasher::s_hasher{};
+}
 
 /**
-* Splits the full ip addresss in to ipv4 and port.
-* Time: O(1)
-* Space: O(1)
-* 
-* @param connection IpAddress of the the connection
-* @return pair of Port and Ip
+* Follows the log as it grows, adding the new lines to the port map and
+* writing the most accessed port report again at every interval it changed.
+* Counts only grow, so the most accessed port is either the last one or one
+* of the ports whose counts changed, and only those are looked at.
+*
+* @param options Options of the run
+* @param [out] portMap Map of the lines read so far, the new ones are added to it
+* @param mostAccessedPortEntry Port with the most connections so far, nullptr if there are none
+* @param logBytes Number of bytes of the log read so far, ending with a line break
+* @param logPrefixHash Hash of those bytes, as given by hashLogPrefix
 */
-std::pair<Port, Ip> getIpAndPortFromAccess(const IpAddress& connection){
-	return std::make_pair<Port, Ip>( connection.m_port, { connection.m_part1, connection.m_part2, connection.m_part3, connection.m_part4 });
-}
+void follow(const Options& options, PortMap& portMap, const PortMap::Entry* mostAccessedPortEntry, uint64_t logBytes, uint64_t logPrefixHash) {
+	DirtyPorts dirtyPorts;
+	followLog(options, logBytes, logPrefixHash,
+		[&portMap, &dirtyPorts](std::string_view lines) { ingestLog(lines, portMap, dirtyPorts); },
+		[&portMap, &dirtyPorts, &mostAccessedPortEntry]() {
+			// The report changes if the most accessed port got new connections or was overtaken
+			bool changed{ mostAccessedPortEntry != nullptr && dirtyPorts.contains(mostAccessedPortEntry->first) };
+			for (const Port& port : dirtyPorts.ports()) {
+				const PortMap::Entry* entry{ portMap.find(port) };
+				if (mostAccessedPortEntry == nullptr || entry->second.getNumConnections() > mostAccessedPortEntry->second.getNumConnections()) {
+					mostAccessedPortEntry = entry;
+					changed = true;
+				}
+			}
+			dirtyPorts.clear();
 
+			if (changed) {
+				writeMostAccessedPort(*mostAccessedPortEntry);
+			}
+		});
+}
 
 /**
-* Helper class extending the hash map to add a counter and manage input connections.
-* 
-* @reutrn IpMap
+* Builds the port map of the log and writes the reports.
+*
+* @param options Options of the run
 */
-class IpMap : public HashMapInternalChaining<Ip, unsigned, Ip::Hasher>{
-	unsigned m_numConnections;
-	
-public:
-	IpMap() : HashMapInternalChaining<Ip, unsigned, Ip::Hasher>{ IP_MAP_SIZE } {}
-
-	void incNumConnections() {
-		m_numConnections++;
-	}
-	
-	unsigned getNumConnections()const {
-		return m_numConnections;
+void run(const Options& options) {
+	// Map the log file, the lines are parsed straight from the mapping while the kernel reads ahead
+	fio::MappedFile logFile{ INPUT_FILE };
+	std::string_view log{ logFile.view() };
+
+	// A followed log may end in a line still being written, leave it for the first poll
+	if (options.followInterval != 0U) {
+		log = log.substr(0U, log.rfind('\n') + 1U);
 	}
 
-};
-
-
-
-void run() {
-	using PortMap = HashMapInternalChaining<Port, IpMap, Port::Hasher>;
-
-	// Read the log file and store the lines for ease of iteration
-	std::vector<std::string> lines{ fio::readLines("bitacora3.txt")};
-
-	// Intialize the port map with the number of buckets corresponding to the lines
-	PortMap portMap{getBucketCount(lines.size())};
-
-	// Iterate through each line
-	for (const auto& line : lines) {
-
-		// Parse the full ip from the line string
-		auto entry{ getIpAndPortFromAccess(parseIpStr(line)) };
-		
-		// Get the port and ip from the entry
-		Port& port{ entry.first };
-		Ip& ip{ entry.second };
-
-		// Look for the port in the port hash map
-		auto res{portMap.find(port)};
-
-		// Port not found, create it
-		if (res == nullptr) {
-			// Create new ip map
-			IpMap ipMap;
-			
-			// Add the new ip with frequency of one
-			ipMap.insert(ip, 1U);
-
-			// Increment the number of total connections
-			ipMap.incNumConnections();
-
-			// Insert the ip map into the 
-			portMap.insert(port, ipMap);
+	// Start from the snapshot, only ingesting the lines appended to the log since it was saved
+	PortMap portMap;
+	size_t logStart{ 0U };
+	if (!options.snapshot.empty()) {
+		logStart = loadLogSnapshot(options.snapshot, log, portMap);
+	}
 
-		}
-		// Port found
-		else {
-			// Get the ip map of the port
-			auto& ipMap{ res->second };
+	// Build the port map, splitting the log between the threads
+	if (options.flat && logStart == 0U) {
+		FlatNetMap netMap;
+		ingestLog(log, netMap, options.numThreads);
+		netMap.buildPortMap(portMap);
+	}
+	else {
+		ingestLog(log.substr(logStart), portMap, options.numThreads);
+	}
 
-			// Attempt to emplace new ip
-			auto res{ipMap.insert(ip, 1U)};
+	const SnapshotInfo info{ log.size(), hashLogPrefix(log, log.size()) };
+	if (!options.snapshot.empty()) {
+		saveSnapshot(options.snapshot, portMap, info);
+	}
 
-			// Increment the number of total connections
-			ipMap.incNumConnections();
+	// Print the built hash map, formatting it on the ingestion threads
+	writeNetMap(NET_MAP_OUTPUT_FILE, portMap, options.numThreads);
 
-			// Check if the element was not emplaced
-			if (!res.first) {
-				// Increment the access count
-				res.second->second++;
-			}
-			
-		}
-		
+	if (options.stats) {
+		writeMapStats(portMap);
 	}
 
-	// Destroy the lines, they are not needed anymore and they take memory
-	lines.~vector();
-	
-	// Open a file to print the map
-	std::ofstream netMapOutFile{ NET_MAP_OUTPUT_FILE };
-	if (!netMapOutFile.is_open()) {
-		std::cerr << "[ERROR] Could not open file '" << NET_MAP_OUTPUT_FILE << "'" << std::endl;
-		std::exit(1);
+	if (!options.ipRange.empty() || !options.portRange.empty()) {
+		writeRangeQuery(portMap, options);
 	}
 
-	// Display the built hash map
-	netMapOutFile << portMap;
-	netMapOutFile.close();
-
 
 	// Scan the map for the most vulnerable port and store it to a reference
 	size_t maxNumConnections{ 0U };
@@ -275,35 +342,342 @@ void run() {
 
 	// Run the callback on each element
 	portMap.forEach(reducerCallback);
+	if (mostAccessedPortEntry != nullptr) {
+		writeMostAccessedPort(*mostAccessedPortEntry);
+	}
+	else if (options.followInterval == 0U) {
+		std::cerr << "[ERROR] The log has no accesses" << std::endl;
+		std::exit(1);
+	}
 
-	std::ofstream portOutFile{ MOST_ACCESSED_PORT_OUTFILE };
-	if (!portOutFile.is_open()) {
-		std::cerr << "[ERROR] Could not open file '" << MOST_ACCESSED_PORT_OUTFILE << "'" << std::endl;
+	if (options.followInterval != 0U) {
+		follow(options, portMap, mostAccessedPortEntry, info.logBytes, info.logPrefixHash);
+	}
+}
+
+/**
+* Summarizes the most accessed ports of the log in bounded memory and writes the
+* most accessed port report, with the error bounds of each count. The net map
+* report needs every port and ip, so it is not written.
+*
+* @param options Options of the run
+*/
+void summarize(const Options& options) {
+	fio::MappedFile logFile{ INPUT_FILE };
+
+	HeavyHitters summary{ options.numTopPorts, HEAVY_HITTER_IPS, options.distinctIpsPrecision };
+	ingestLog(logFile.view(), summary, options.numThreads);
+
+	const auto topPorts{ summary.topPorts(NUM_REPORTED_TOP_PORTS) };
+	if (topPorts.empty()) {
+		std::cerr << "[ERROR] The log has no accesses" << std::endl;
 		std::exit(1);
 	}
 
-	// Print the port summary to the file in json format
-	portOutFile << "{\n" <<
-		"    \"mostAccessedPort\": " << '\"'<<mostAccessedPortEntry->first << '\"' << ",\n" <<
-		"    \"numberConnections\": " << '\"' << maxNumConnections << '\"' << ",\n" <<
-		"    \"ips\": " << "{\n";
-	size_t commaCounter{maxNumConnections};
-	mostAccessedPortEntry->second.forEach(
-		[&portOutFile, &commaCounter](const IpMap::Entry& entry) {
-			commaCounter -= entry.second;
-			portOutFile << "        \"" << entry.first << "\": " << entry.second << (commaCounter != 0 ? ",\n" : "\n");
+	ReportWriter portOutFile{ MOST_ACCESSED_PORT_OUTFILE };
+	ReportBuffer& out{ portOutFile.buffer() };
+
+	// Counts are upper bounds, each one is at most its error above the true count
+	const auto& mostAccessedPort{ topPorts.front() };
+	const auto ips{ summary.topIps(mostAccessedPort.key, HEAVY_HITTER_IPS) };
+	const PortCardinality& distinctIps{ summary.distinctIps() };
+	out.append("{\n    \"mostAccessedPort\": \"").append(mostAccessedPort.key).append("\",\n")
+		.append("    \"numberConnections\": \"").appendNumber(mostAccessedPort.count).append("\",\n")
+		.append("    \"maxError\": \"").appendNumber(mostAccessedPort.error).append("\",\n");
+	if (distinctIps.enabled()) {
+		out.append("    \"distinctIps\": \"").appendNumber(distinctIps.estimate(mostAccessedPort.key)).append("\",\n");
+	}
+	out.append("    \"ips\": {\n");
+	for (size_t i{ 0U }; i < ips.size(); ++i) {
+		out.append("        \"").append(ips[i].key).append("\": ").appendNumber(ips[i].count).append(i + 1U != ips.size() ? ",\n" : "\n");
+	}
+	out.append("    },\n    \"ipsMaxError\": \"").appendNumber(mostAccessedPort.error + (ips.empty() ? 0U : ips.back().error)).append("\",\n")
+		.append("    \"topPorts\": [\n");
+	for (size_t i{ 0U }; i < topPorts.size(); ++i) {
+		out.append("        { \"port\": \"").append(topPorts[i].key).append("\", \"numberConnections\": \"").appendNumber(topPorts[i].count)
+			.append("\", \"maxError\": \"").appendNumber(topPorts[i].error).append('\"');
+		if (distinctIps.enabled()) {
+			out.append(", \"distinctIps\": \"").appendNumber(distinctIps.estimate(topPorts[i].key)).append('\"');
 		}
-	);
-	portOutFile << "    }\n}";
-		
-	// Close the outpu file
+		out.append(" }").append(i + 1U != topPorts.size() ? ",\n" : "\n");
+	}
+	out.append("    ]\n}");
 	portOutFile.close();
 }
 
-int main() {
+/**
+* Writes the report of the most accessed port in the latest minutes of the log.
+*
+* @param windows Time windows of the log
+* @param windowMinutes Length of the window in minutes
+*/
+void writeWindowPort(const TimeWindows& windows, unsigned windowMinutes) {
+	const uint32_t windowSeconds{ windowMinutes * 60U };
+	const auto topPorts{ windows.topPorts(windowSeconds, 1U) };
+	if (topPorts.empty()) {
+		std::cerr << "[WARNING] The log has no accesses with a timestamp" << std::endl;
+		return;
+	}
+
+	const auto& mostAccessedPort{ topPorts.front() };
+	const auto ips{ windows.ips(mostAccessedPort.first, windowSeconds) };
+	ReportWriter portOutFile{ WINDOW_PORT_OUTPUT_FILE };
+	ReportBuffer& out{ portOutFile.buffer() };
+	out.append("{\n    \"windowMinutes\": \"").appendNumber(windowMinutes).append("\",\n")
+		.append("    \"mostAccessedPort\": \"").append(mostAccessedPort.first).append("\",\n")
+		.append("    \"numberConnections\": \"").appendNumber(mostAccessedPort.second).append("\",\n")
+		.append("    \"ips\": {\n");
+	for (size_t i{ 0U }; i < ips.size(); ++i) {
+		out.append("        \"").append(ips[i].first).append("\": ").appendNumber(ips[i].second).append(i + 1U != ips.size() ? ",\n" : "\n");
+		portOutFile.flushIfFull();
+	}
+	out.append("    }\n}");
+	portOutFile.close();
+}
+
+/**
+* Counts the accesses of the log in per minute time slots of its latest day
+* and writes the report of the most accessed port in its latest minutes. With
+* --follow, the new lines are added to the slots and the report is written
+* again at every interval with new lines, without looking at the older slots.
+*
+* @param options Options of the run
+*/
+void runWindows(const Options& options) {
+	fio::MappedFile logFile{ INPUT_FILE };
+	std::string_view log{ logFile.view() };
+	if (options.followInterval != 0U) {
+		log = log.substr(0U, log.rfind('\n') + 1U);
+	}
+
+	TimeWindows windows;
+	ingestLog(log, windows, options.numThreads);
+	writeWindowPort(windows, options.windowMinutes);
+
+	if (options.followInterval != 0U) {
+		bool changed{ false };
+		followLog(options, log.size(), hashLogPrefix(log, log.size()),
+			[&windows, &changed](std::string_view lines) {
+				ingestLog(lines, windows, 1U);
+				changed = true;
+			},
+			[&windows, &changed, &options]() {
+				if (changed) {
+					writeWindowPort(windows, options.windowMinutes);
+					changed = false;
+				}
+			});
+	}
+}
+
+/**
+* Counts the accesses of the log by the reason of the failure and the user
+* name of their messages and writes the totals of each reason, the user names
+* tried the most and the reasons of the accesses of the most accessed port.
+*
+* @param options Options of the run
+*/
+void runReasons(const Options& options) {
+	fio::MappedFile logFile{ INPUT_FILE };
+	ReasonStats reasons;
+	ingestLog(logFile.view(), reasons, options.numThreads);
+
+	// Accesses of each port, added up from its counts of each reason
+	std::vector<uint64_t> portTotals(size_t{ 1U } << 16, 0U);
+	reasons.forEachPortReason([&portTotals](const Port& port, uint32_t, uint64_t count) {
+		portTotals[port.port()] += count;
+	});
+	const auto mostAccessed{ std::max_element(portTotals.begin(), portTotals.end()) };
+	if (*mostAccessed == 0U) {
+		std::cerr << "[ERROR] The log has no accesses" << std::endl;
+		std::exit(1);
+	}
+	const Port mostAccessedPort{ static_cast<uint16_t>(mostAccessed - portTotals.begin()) };
+
+	ReportWriter reasonsOutFile{ REASONS_OUTPUT_FILE };
+	ReportBuffer& out{ reasonsOutFile.buffer() };
+	out.append("{\n    \"reasons\": [\n");
+	for (uint32_t id{ 0U }; id < reasons.reasonCount(); ++id) {
+		out.append("        { \"reason\": ").appendJsonString(reasons.reason(id))
+			.append(", \"numberConnections\": \"").appendNumber(reasons.reasonTotal(id)).append("\" }")
+			.append(id + 1U != reasons.reasonCount() ? ",\n" : "\n");
+	}
+	const auto topUsers{ reasons.topUsers(NUM_REPORTED_TOP_USERS) };
+	out.append("    ],\n    \"topUsers\": [\n");
+	for (size_t i{ 0U }; i < topUsers.size(); ++i) {
+		out.append("        { \"user\": ").appendJsonString(reasons.user(topUsers[i].first))
+			.append(", \"numberConnections\": \"").appendNumber(topUsers[i].second).append("\" }")
+			.append(i + 1U != topUsers.size() ? ",\n" : "\n");
+	}
+	out.append("    ],\n    \"mostAccessedPort\": \"").append(mostAccessedPort).append("\",\n")
+		.append("    \"numberConnections\": \"").appendNumber(*mostAccessed).append("\",\n")
+		.append("    \"portReasons\": {\n");
+	bool first{ true };
+	for (uint32_t id{ 0U }; id < reasons.reasonCount(); ++id) {
+		const uint64_t count{ reasons.portCount(mostAccessedPort, id) };
+		if (count != 0U) {
+			out.append(first ? "" : ",\n").append("        ").appendJsonString(reasons.reason(id)).append(": ").appendNumber(count);
+			first = false;
+		}
+	}
+	out.append("\n    }\n}");
+	reasonsOutFile.close();
+}
+
+/**
+* Appends a network to a report, such as "80.169.0.0/16".
+*/
+void appendNetwork(ReportBuffer& out, uint32_t address, unsigned length) {
+	out.append(Ip{ address }).append('/').appendNumber(length);
+}
+
+/**
+* Counts the ips of each port of the log in prefix tries and writes the
+* networks the accesses of a port come from the most, by default of the
+* most accessed port, along with the accesses matched to each blocklist
+* network when there is a blocklist.
+*
+* @param options Options of the run
+*/
+void runSubnets(const Options& options) {
+	Blocklist blocklist;
+	if (!options.blocklist.empty()) {
+		blocklist = loadBlocklist(options.blocklist);
+	}
+
+	fio::MappedFile logFile{ INPUT_FILE };
+	SubnetMap subnets{ options.blocklist.empty() ? nullptr : &blocklist };
+	ingestLog(logFile.view(), subnets, options.numThreads);
+
+	// The total of a trie is the number of accesses of its port
+	Port port{ static_cast<uint16_t>(options.subnetPort < 0 ? 0 : options.subnetPort) };
+	const PrefixTrie* trie{ subnets.find(port) };
+	if (options.subnetPort < 0) {
+		subnets.forEachPort([&port, &trie](const Port& other, const PrefixTrie& otherTrie) {
+			if (trie == nullptr || otherTrie.total() > trie->total() || (otherTrie.total() == trie->total() && other.port() < port.port())) {
+				port = other;
+				trie = &otherTrie;
+			}
+		});
+	}
+	if (trie == nullptr) {
+		std::cerr << "[ERROR] The log has no accesses" << (options.subnetPort < 0 ? "" : " on the port") << std::endl;
+		std::exit(1);
+	}
+
+	ReportWriter subnetsOutFile{ SUBNETS_OUTPUT_FILE };
+	ReportBuffer& out{ subnetsOutFile.buffer() };
+	out.append("{\n    \"port\": \"").append(port).append("\",\n")
+		.append("    \"numberConnections\": \"").appendNumber(trie->total()).append("\",\n")
+		.append("    \"networks\": {\n");
+	for (size_t l{ 0U }; l < std::size(REPORTED_NETWORK_LENGTHS); ++l) {
+		const auto networks{ trie->topPrefixes(REPORTED_NETWORK_LENGTHS[l], NUM_REPORTED_TOP_NETWORKS) };
+		out.append("        \"/").appendNumber(REPORTED_NETWORK_LENGTHS[l]).append("\": [\n");
+		for (size_t i{ 0U }; i < networks.size(); ++i) {
+			out.append("            { \"network\": \"");
+			appendNetwork(out, networks[i].address, networks[i].length);
+			out.append("\", \"numberConnections\": \"").appendNumber(networks[i].count).append("\" }")
+				.append(i + 1U != networks.size() ? ",\n" : "\n");
+		}
+		out.append("        ]").append(l + 1U != std::size(REPORTED_NETWORK_LENGTHS) ? ",\n" : "\n");
+	}
+	out.append("    }");
+
+	// Blocklist matches are over the accesses of every port
+	if (!options.blocklist.empty()) {
+		out.append(",\n    \"blocklist\": [\n");
+		for (uint32_t i{ 0U }; i < blocklist.size(); ++i) {
+			out.append("        { \"network\": \"");
+			appendNetwork(out, blocklist.address(i), blocklist.length(i));
+			out.append("\", \"numberConnections\": \"").appendNumber(subnets.blocked(i)).append("\" }")
+				.append(i + 1U != blocklist.size() ? ",\n" : "\n");
+			subnetsOutFile.flushIfFull();
+		}
+		out.append("    ]");
+	}
+	out.append("\n}");
+	subnetsOutFile.close();
+}
+
+int main(int argc, char* argv[]) {
+	Options options{ 0U, false, false, "", 0U, 0U, 0U, 0U, false, false, -1, "", "", "" };
+	for (int i{ 1 }; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--threads" && i + 1 < argc) {
+			options.numThreads = static_cast<unsigned>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--flat") {
+			options.flat = true;
+		}
+		else if (arg == "--stats") {
+			options.stats = true;
+		}
+		else if (arg == "--snapshot" && i + 1 < argc) {
+			options.snapshot = argv[++i];
+		}
+		else if (arg == "--follow" && i + 1 < argc) {
+			options.followInterval = std::max(static_cast<unsigned>(std::stoul(argv[++i])), 1U);
+		}
+		else if (arg == "--window" && i + 1 < argc) {
+			options.windowMinutes = std::max(static_cast<unsigned>(std::stoul(argv[++i])), 1U);
+		}
+		else if (arg == "--top" && i + 1 < argc) {
+			options.numTopPorts = std::max(std::stoul(argv[++i]), 1UL);
+		}
+		else if (arg == "--distinct" && i + 1 < argc) {
+			options.distinctIpsPrecision = static_cast<unsigned>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--reasons") {
+			options.reasons = true;
+		}
+		else if (arg == "--subnets") {
+			options.subnets = true;
+		}
+		else if (arg == "--port" && i + 1 < argc) {
+			options.subnetPort = static_cast<int>(std::min(std::stoul(argv[++i]), 65535UL));
+		}
+		else if (arg == "--blocklist" && i + 1 < argc) {
+			options.blocklist = argv[++i];
+		}
+		else if (arg == "--ip-range" && i + 1 < argc) {
+			options.ipRange = argv[++i];
+			uint32_t first, last;
+			if (!parseIpRange(options.ipRange, first, last)) {
+				std::cerr << "[ERROR] Malformed ip range '" << options.ipRange << "'" << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--port-range" && i + 1 < argc) {
+			options.portRange = argv[++i];
+			uint16_t first, last;
+			if (!parsePortRange(options.portRange, first, last)) {
+				std::cerr << "[ERROR] Malformed port range '" << options.portRange << "'" << std::endl;
+				return 1;
+			}
+		}
+		else {
+			std::cerr << "[ERROR] Unknown argument '" << arg << "'. Usage: " << argv[0] << " [--threads N] [--flat] [--stats] [--snapshot FILE] [--ip-range FIRST-LAST|NETWORK] [--port-range FIRST-LAST] [--follow SECONDS] [--window MINUTES | --top N [--distinct P] | --reasons | --subnets [--port N] [--blocklist FILE]]" << std::endl;
+			return 1;
+		}
+	}
+
 	Timer timer;
 	try {
-		run();
+		if (options.windowMinutes != 0U) {
+			runWindows(options);
+		}
+		else if (options.reasons) {
+			runReasons(options);
+		}
+		else if (options.subnets) {
+			runSubnets(options);
+		}
+		else if (options.numTopPorts != 0U) {
+			summarize(options);
+		}
+		else {
+			run(options);
+		}
 	}
 	catch (std::exception& e) {
 		std::cerr << e.what(); 